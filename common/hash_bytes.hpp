@@ -0,0 +1,16 @@
+#ifndef HASH_BYTES_HPP
+#define HASH_BYTES_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+// FNV-1a, identifies cache sources and simulation states.
+inline uint64_t HashBytes(const void* data, size_t size, uint64_t hash = 14695981039346656037ull){
+    const uint8_t* p = (const uint8_t*)data;
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ p[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef RENAME_OVER_HPP
+#define RENAME_OVER_HPP
+
+#include <cstdio>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
+
+// Renames from to to, replacing to if it exists. Readers of to see the old
+// file or the new one, never none: the caches write under a temporary name
+// and rename over the old cache.
+inline bool RenameOver(const char* from, const char* to){
+#ifdef _WIN32
+    return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    return rename(from, to) == 0;
+#endif
+}
+
+#endif
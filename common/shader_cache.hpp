@@ -0,0 +1,301 @@
+#ifndef SHADER_CACHE_HPP
+#define SHADER_CACHE_HPP
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include "hash_bytes.hpp"
+#include "rename_over.hpp"
+
+// LoadShaders for several programs at once, with a cache of the linked
+// program binaries. A program is stored next to its vertex shader as
+// "<vertex shader>.<fragment shader file>.programcache", keyed by a hash
+// of both sources, the captured outputs and the GL vendor, renderer and
+// version, so an edited shader or another driver compiles again and
+// rewrites the cache.
+// The programs that miss are compiled together: every compile and link is
+// issued before any status is read, a driver with compiler threads
+// (KHR/ARB_parallel_shader_compile) works on them in parallel.
+
+// A program without a fragment shader is a vertex shader linked alone,
+// "<vertex shader>.programcache" in the cache. Its feedback varyings are
+// captured interleaved with transform feedback.
+struct ShaderProgramFiles {
+    const char* vertex_file_path;
+    const char* fragment_file_path;         // or nullptr
+    const char* const* feedback_varyings;   // or nullptr
+    int feedback_varying_count;
+};
+
+struct ProgramCacheHeader {
+    char magic[4];          // "PRGC"
+    uint32_t version;
+    uint64_t key;           // sources and driver
+    uint32_t binary_format;
+    uint32_t binary_size;
+};
+
+const uint32_t ProgramCacheVersion = 2;
+
+inline bool ReadShaderFile(const char* path, std::string& code){
+    FILE* f = fopen(path, "rb");
+    if (f == nullptr) {
+        printf("Impossible to open %s. Are you in the right directory ? Don't forget to read the FAQ !\n", path);
+        return false;
+    }
+    code.clear();
+    char chunk[4096];
+    size_t read;
+    while ((read = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+        code.append(chunk, read);
+    }
+    fclose(f);
+    return true;
+}
+
+inline std::string ProgramCachePath(const ShaderProgramFiles& files){
+    if (files.fragment_file_path == nullptr) {
+        return std::string(files.vertex_file_path) + ".programcache";
+    }
+    const char* fragment_name = files.fragment_file_path;
+    for (const char* p = files.fragment_file_path; *p != '\0'; ++p) {
+        if (*p == '/' || *p == '\\') {
+            fragment_name = p + 1;
+        }
+    }
+    return std::string(files.vertex_file_path) + "." + fragment_name + ".programcache";
+}
+
+inline uint64_t ProgramCacheKey(const ShaderProgramFiles& files, const std::string& vertex_code,
+                                const std::string& fragment_code){
+    uint64_t key = HashBytes(&ProgramCacheVersion, sizeof(ProgramCacheVersion));
+    const GLenum driver_strings[3] = {GL_VENDOR, GL_RENDERER, GL_VERSION};
+    for (GLenum name : driver_strings) {
+        const char* value = (const char*)glGetString(name);
+        if (value != nullptr) {
+            key = HashBytes(value, strlen(value) + 1, key);
+        }
+    }
+    for (int i = 0; i < files.feedback_varying_count; ++i) {
+        key = HashBytes(files.feedback_varyings[i], strlen(files.feedback_varyings[i]) + 1, key);
+    }
+    key = HashBytes(vertex_code.data(), vertex_code.size() + 1, key);
+    return HashBytes(fragment_code.data(), fragment_code.size(), key);
+}
+
+// A 3.3 context has program binaries through ARB_get_program_binary, and
+// drivers may still offer no format at all.
+inline bool ProgramBinariesSupported(){
+    if (!glfwExtensionSupported("GL_ARB_get_program_binary")) {
+        return false;
+    }
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    return formats > 0;
+}
+
+// Lets the driver compile on as many threads as it likes.
+inline void EnableParallelShaderCompile(){
+    typedef void (APIENTRY *MaxShaderCompilerThreads)(GLuint count);
+    const char* name = nullptr;
+    if (glfwExtensionSupported("GL_KHR_parallel_shader_compile")) {
+        name = "glMaxShaderCompilerThreadsKHR";
+    } else if (glfwExtensionSupported("GL_ARB_parallel_shader_compile")) {
+        name = "glMaxShaderCompilerThreadsARB";
+    }
+    if (name != nullptr) {
+        MaxShaderCompilerThreads set_threads = (MaxShaderCompilerThreads)glfwGetProcAddress(name);
+        if (set_threads != nullptr) {
+            set_threads(0xFFFFFFFFu);
+        }
+    }
+}
+
+// The program from the cache, 0 if there is none for key or the driver
+// doesn't take the binary.
+inline GLuint LoadProgramBinary(const std::string& path, uint64_t key){
+    FILE* f = fopen(path.c_str(), "rb");
+    if (f == nullptr) {
+        return 0;
+    }
+    ProgramCacheHeader header;
+    std::vector<char> binary;
+    bool ok = fread(&header, sizeof(header), 1, f) == 1 &&
+              memcmp(header.magic, "PRGC", 4) == 0 &&
+              header.version == ProgramCacheVersion &&
+              header.key == key;
+    if (ok) {
+        binary.resize(header.binary_size);
+        ok = fread(binary.data(), 1, binary.size(), f) == binary.size();
+    }
+    fclose(f);
+    if (!ok) {
+        return 0;
+    }
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, header.binary_format, binary.data(), (GLsizei)binary.size());
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (linked != GL_TRUE) {
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+inline bool SaveProgramBinary(const std::string& path, uint64_t key, GLuint program){
+    GLint size = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &size);
+    if (size <= 0) {
+        return false;
+    }
+    std::vector<char> binary(size);
+    GLenum format = 0;
+    glGetProgramBinary(program, size, &size, &format, binary.data());
+
+    ProgramCacheHeader header;
+    memcpy(header.magic, "PRGC", 4);
+    header.version = ProgramCacheVersion;
+    header.key = key;
+    header.binary_format = format;
+    header.binary_size = (uint32_t)size;
+
+    // written under a temporary name and renamed, like the mesh cache
+    std::string tmp_path = path + ".tmp";
+    FILE* f = fopen(tmp_path.c_str(), "wb");
+    if (f == nullptr) {
+        fprintf(stderr, "can't write %s\n", tmp_path.c_str());
+        return false;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+              fwrite(binary.data(), 1, (size_t)size, f) == (size_t)size;
+    ok = fclose(f) == 0 && ok;
+    if (!ok || !RenameOver(tmp_path.c_str(), path.c_str())) {
+        fprintf(stderr, "can't write %s\n", path.c_str());
+        remove(tmp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Prints the info log of a shader or program, if there is one.
+inline void PrintShaderLog(GLuint object, bool is_program){
+    int log_length = 0;
+    if (is_program) {
+        glGetProgramiv(object, GL_INFO_LOG_LENGTH, &log_length);
+    } else {
+        glGetShaderiv(object, GL_INFO_LOG_LENGTH, &log_length);
+    }
+    if (log_length > 1) {
+        std::vector<char> log(log_length + 1);
+        if (is_program) {
+            glGetProgramInfoLog(object, log_length, nullptr, log.data());
+        } else {
+            glGetShaderInfoLog(object, log_length, nullptr, log.data());
+        }
+        printf("%s\n", log.data());
+    }
+}
+
+// Fills programs[0, count), a program that fails to build is 0. Returns
+// false if any did. Prints the setup time and the cache hits.
+inline bool LoadShaderPrograms(const ShaderProgramFiles* files, int count, GLuint* programs){
+    double start = glfwGetTime();
+    bool binaries = ProgramBinariesSupported();
+    EnableParallelShaderCompile();
+
+    struct Build {
+        GLuint shaders[2];
+        std::string cache_path;
+        uint64_t key;
+    };
+    std::vector<Build> builds(count);
+    int cached = 0;
+    for (int i = 0; i < count; ++i) {
+        Build& build = builds[i];
+        build.shaders[0] = build.shaders[1] = 0;
+        programs[i] = 0;
+        std::string vertex_code, fragment_code;
+        if (!ReadShaderFile(files[i].vertex_file_path, vertex_code) ||
+            (files[i].fragment_file_path != nullptr && !ReadShaderFile(files[i].fragment_file_path, fragment_code))) {
+            continue;
+        }
+        build.key = ProgramCacheKey(files[i], vertex_code, fragment_code);
+        build.cache_path = ProgramCachePath(files[i]);
+        if (binaries && (programs[i] = LoadProgramBinary(build.cache_path, build.key)) != 0) {
+            cached += 1;
+            continue;
+        }
+        const std::string* codes[2] = {&vertex_code, &fragment_code};
+        const GLenum types[2] = {GL_VERTEX_SHADER, GL_FRAGMENT_SHADER};
+        int shader_count = files[i].fragment_file_path != nullptr ? 2 : 1;
+        for (int s = 0; s < shader_count; ++s) {
+            build.shaders[s] = glCreateShader(types[s]);
+            const char* source = codes[s]->c_str();
+            glShaderSource(build.shaders[s], 1, &source, nullptr);
+            glCompileShader(build.shaders[s]);
+        }
+    }
+    for (int i = 0; i < count; ++i) {
+        Build& build = builds[i];
+        if (build.shaders[0] == 0) {
+            continue;
+        }
+        programs[i] = glCreateProgram();
+        for (int s = 0; s < 2 && build.shaders[s] != 0; ++s) {
+            glAttachShader(programs[i], build.shaders[s]);
+        }
+        if (files[i].feedback_varying_count > 0) {
+            glTransformFeedbackVaryings(programs[i], files[i].feedback_varying_count, files[i].feedback_varyings,
+                                        GL_INTERLEAVED_ATTRIBS);
+        }
+        if (binaries) {
+            glProgramParameteri(programs[i], GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
+        glLinkProgram(programs[i]);
+    }
+
+    // the first status query waits for the compiler
+    bool all_built = true;
+    for (int i = 0; i < count; ++i) {
+        Build& build = builds[i];
+        if (build.shaders[0] == 0) {
+            all_built = all_built && programs[i] != 0;
+            continue;
+        }
+        const char* paths[2] = {files[i].vertex_file_path, files[i].fragment_file_path};
+        for (int s = 0; s < 2 && build.shaders[s] != 0; ++s) {
+            GLint compiled = GL_FALSE;
+            glGetShaderiv(build.shaders[s], GL_COMPILE_STATUS, &compiled);
+            if (compiled != GL_TRUE) {
+                printf("Compiling shader : %s\n", paths[s]);
+                PrintShaderLog(build.shaders[s], false);
+            }
+        }
+        GLint linked = GL_FALSE;
+        glGetProgramiv(programs[i], GL_LINK_STATUS, &linked);
+        if (linked != GL_TRUE) {
+            printf("Linking program : %s, %s\n", paths[0], paths[1] != nullptr ? paths[1] : "no fragment shader");
+            PrintShaderLog(programs[i], true);
+        }
+        for (int s = 0; s < 2 && build.shaders[s] != 0; ++s) {
+            glDetachShader(programs[i], build.shaders[s]);
+            glDeleteShader(build.shaders[s]);
+        }
+        if (linked != GL_TRUE) {
+            glDeleteProgram(programs[i]);
+            programs[i] = 0;
+            all_built = false;
+        } else if (binaries) {
+            SaveProgramBinary(build.cache_path, build.key, programs[i]);
+        }
+    }
+    printf("shaders: %d programs, %d from the cache, %.1f ms\n", count, cached, (glfwGetTime() - start) * 1000.0);
+    return all_built;
+}
+
+#endif
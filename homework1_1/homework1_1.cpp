@@ -14,7 +14,7 @@ GLFWwindow* window;
 #include <glm/gtc/matrix_transform.hpp>
 using namespace glm;
 
-#include <common/shader.hpp>
+#include "../common/shader_cache.hpp"
 
 int main( void )
 {
@@ -57,13 +57,19 @@ int main( void )
 	// Dark blue background
 	glClearColor(0.0f, 0.0f, 0.4f, 0.0f);
 
-	GLuint VertexArrayID;
-	glGenVertexArrays(1, &VertexArrayID);
-	glBindVertexArray(VertexArrayID);
+	// One VAO per triangle
+	GLuint VertexArrayIDs[2];
+	glGenVertexArrays(2, VertexArrayIDs);
 
 	// Create and compile our GLSL program from the shaders
-	GLuint programID1 = LoadShaders( "SimpleVertexShader.vertexshader", "SimpleFragmentShaderRed.fragmentshader" );
-	GLuint programID2 = LoadShaders( "MyVertexShader.vertexshader", "MyFragmentShaderYellow.fragmentshader" );
+	const ShaderProgramFiles program_files[2] = {
+		{ "SimpleVertexShader.vertexshader", "SimpleFragmentShaderRed.fragmentshader" },
+		{ "MyVertexShader.vertexshader", "MyFragmentShaderYellow.fragmentshader" },
+	};
+	GLuint programIDs[2];
+	LoadShaderPrograms(program_files, 2, programIDs);
+	GLuint programID1 = programIDs[0];
+	GLuint programID2 = programIDs[1];
 
     GLuint MatrixID1 = glGetUniformLocation(programID1, "MVP");
     GLuint MatrixID2 = glGetUniformLocation(programID2, "MVP");
@@ -96,6 +102,22 @@ int main( void )
     glBindBuffer(GL_ARRAY_BUFFER, vertexBuffers[1]);
     glBufferData(GL_ARRAY_BUFFER, sizeof(g_vertex_buffer_data2), g_vertex_buffer_data2, GL_STATIC_DRAW);
 
+	// The attributes never change, so each VAO is configured once here
+	// instead of every frame.
+	for (int i = 0; i < 2; ++i) {
+		glBindVertexArray(VertexArrayIDs[i]);
+		glEnableVertexAttribArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, vertexBuffers[i]);
+		glVertexAttribPointer(
+			0,                  // attribute 0. No particular reason for 0, but must match the layout in the shader.
+			3,                  // size
+			GL_FLOAT,           // type
+			GL_FALSE,           // normalized?
+			0,                  // stride
+			(void*)0            // array buffer offset
+		);
+	}
+
 	do{
         GLfloat radius = 1.5f;
         GLfloat camX = sin(glfwGetTime()) * radius;
@@ -113,40 +135,17 @@ int main( void )
 
         glUniformMatrix4fv(MatrixID1, 1, GL_FALSE, &MVP[0][0]);
 
-		// 1rst attribute buffer : vertices
-		glEnableVertexAttribArray(0);
-		glBindBuffer(GL_ARRAY_BUFFER, vertexBuffers[0]);
-		glVertexAttribPointer(
-			0,                  // attribute 0. No particular reason for 0, but must match the layout in the shader.
-			3,                  // size
-			GL_FLOAT,           // type
-			GL_FALSE,           // normalized?
-			0,                  // stride
-			(void*)0            // array buffer offset
-		);
-
 		// Draw the triangle !
+		glBindVertexArray(VertexArrayIDs[0]);
 		glDrawArrays(GL_TRIANGLES, 0, 3); // 3 indices starting at 0 -> 1 triangle
-        glDisableVertexAttribArray(0);
 
         glUseProgram(programID2);
 
         glUniformMatrix4fv(MatrixID2, 1, GL_FALSE, &MVP[0][0]);
 
-        glEnableVertexAttribArray(0);
-        glBindBuffer(GL_ARRAY_BUFFER, vertexBuffers[1]);
-        glVertexAttribPointer(
-                0,                  // attribute 0. No particular reason for 0, but must match the layout in the shader.
-                3,                  // size
-                GL_FLOAT,           // type
-                GL_FALSE,           // normalized?
-                0,                  // stride
-                (void*)0            // array buffer offset
-        );
+        glBindVertexArray(VertexArrayIDs[1]);
         glDrawArrays(GL_TRIANGLES, 0, 3); // 3 indices starting at 0 -> 1 triangle
 
-		glDisableVertexAttribArray(0);
-
 		// Swap buffers
 		glfwSwapBuffers(window);
 		glfwPollEvents();
@@ -157,7 +156,7 @@ int main( void )
 
 	// Cleanup VBO
     glDeleteBuffers(2, vertexBuffers);
-	glDeleteVertexArrays(1, &VertexArrayID);
+	glDeleteVertexArrays(2, VertexArrayIDs);
     glDeleteProgram(programID1);
     glDeleteProgram(programID2);
 
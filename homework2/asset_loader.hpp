@@ -0,0 +1,123 @@
+#ifndef ASSET_LOADER_HPP
+#define ASSET_LOADER_HPP
+
+#include <functional>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include "async_log.hpp"
+
+// Loads assets in the background. Every asset has a decode step (file I/O,
+// parsing, no GL calls) that runs on the loader's worker thread and an
+// upload step that runs on the GL thread from Pump, once its decode is done.
+// Both steps usually share the decoded data through a shared_ptr.
+// Asset names are logged by pointer, they must outlive the program's log
+// (literals).
+class AssetLoader {
+public:
+    typedef std::function<void()> Step;
+
+    AssetLoader() {}
+    ~AssetLoader() { Stop(); }
+
+    void Start(){
+        start_time = std::chrono::steady_clock::now();
+        stopping = false;
+        worker = std::thread(&AssetLoader::Run, this);
+    }
+
+    // Waits for the decode in progress, queued assets are dropped.
+    void Stop(){
+        if (!worker.joinable()) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_one();
+        worker.join();
+    }
+
+    void Load(const char* name, Step decode, Step upload){
+        Asset asset = {name, decode, upload};
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            decode_queue.push_back(asset);
+        }
+        pending += 1;
+        wake.notify_one();
+    }
+
+    // GL thread: runs the uploads of decoded assets until budget_seconds
+    // are used up. At least one upload runs per call, so a single upload
+    // over the budget still goes through. Logs when each asset is
+    // resident, in ms since Start.
+    void Pump(double budget_seconds){
+        if (pending == 0) {
+            return;
+        }
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (;;) {
+            Asset asset;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (upload_queue.empty()) {
+                    return;
+                }
+                asset = upload_queue.front();
+                upload_queue.pop_front();
+            }
+            asset.upload();
+            pending -= 1;
+            std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+            std::chrono::duration<double, std::milli> since_start = now - start_time;
+            LOG_INFO("%s: resident after %.1f ms\n", asset.name, since_start.count());
+            std::chrono::duration<double> used = now - start;
+            if (used.count() >= budget_seconds) {
+                return;
+            }
+        }
+    }
+
+    // Every asset given to Load is uploaded.
+    bool idle() const { return pending == 0; }
+
+private:
+    struct Asset {
+        const char* name;
+        Step decode;
+        Step upload;
+    };
+
+    void Run(){
+        for (;;) {
+            Asset asset;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this] { return stopping || !decode_queue.empty(); });
+                if (stopping) {
+                    return;
+                }
+                asset = decode_queue.front();
+                decode_queue.pop_front();
+            }
+            asset.decode();
+            std::lock_guard<std::mutex> lock(mutex);
+            upload_queue.push_back(asset);
+        }
+    }
+
+    std::chrono::steady_clock::time_point start_time;
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<Asset> decode_queue;
+    std::deque<Asset> upload_queue;
+    bool stopping = false;
+    int pending = 0; // GL thread only
+};
+
+#endif
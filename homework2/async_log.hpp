@@ -0,0 +1,277 @@
+#ifndef ASYNC_LOG_HPP
+#define ASYNC_LOG_HPP
+
+#include <atomic>
+#include <algorithm>
+#include <thread>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+
+// Logging off the frame thread. LOG_INFO("%d enemies\n", n) copies the
+// format pointer and up to MaxLogArgs numbers or strings into a fixed
+// record in a lock-free ring. The logger thread formats and writes the
+// records in order, info and debug to stdout, warnings and errors to
+// stderr. When the ring is full the record is dropped and counted, a
+// logging thread never waits.
+//
+// The format and every %s argument are stored as pointers, they must
+// outlive the record: literals, argv, statics. Length modifiers in the
+// format (%zu, %lu) are accepted and ignored, integers are kept as 64 bit.
+//
+// Levels below LOG_LEVEL are compiled out.
+
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO 1
+#define LOG_LEVEL_WARNING 2
+#define LOG_LEVEL_ERROR 3
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+enum LogLevel { LogDebug, LogInfo, LogWarning, LogError };
+
+const int MaxLogArgs = 6;
+const size_t LogCapacity = 1024;        // records, a power of two
+const size_t MaxLogLineLength = 512;
+
+struct LogArg {
+    enum Type : uint8_t { Signed, Unsigned, Double, String } type;
+    union {
+        long long i;
+        unsigned long long u;
+        double d;
+        const char* s;
+    };
+};
+
+inline LogArg MakeLogArg(int v)                { LogArg a; a.type = LogArg::Signed; a.i = v; return a; }
+inline LogArg MakeLogArg(long v)               { LogArg a; a.type = LogArg::Signed; a.i = v; return a; }
+inline LogArg MakeLogArg(long long v)          { LogArg a; a.type = LogArg::Signed; a.i = v; return a; }
+inline LogArg MakeLogArg(unsigned v)           { LogArg a; a.type = LogArg::Unsigned; a.u = v; return a; }
+inline LogArg MakeLogArg(unsigned long v)      { LogArg a; a.type = LogArg::Unsigned; a.u = v; return a; }
+inline LogArg MakeLogArg(unsigned long long v) { LogArg a; a.type = LogArg::Unsigned; a.u = v; return a; }
+inline LogArg MakeLogArg(double v)             { LogArg a; a.type = LogArg::Double; a.d = v; return a; }
+inline LogArg MakeLogArg(const char* v)        { LogArg a; a.type = LogArg::String; a.s = v; return a; }
+
+struct LogRecord {
+    const char* format;
+    LogArg args[MaxLogArgs];
+    uint8_t arg_count;
+    uint8_t level;
+};
+
+// Writes the record's text to out, cut to size. Returns its length.
+inline size_t FormatLogRecord(const LogRecord& record, char* out, size_t size){
+    size_t n = 0;
+    int arg = 0;
+    const char* f = record.format;
+    while (*f != '\0' && n + 1 < size) {
+        if (*f != '%') {
+            out[n++] = *f++;
+            continue;
+        }
+        if (f[1] == '%') {
+            out[n++] = '%';
+            f += 2;
+            continue;
+        }
+        // %[flags][width][.precision] of the format, then our own length
+        char spec[32];
+        size_t s = 0;
+        spec[s++] = *f++;
+        while (*f != '\0' && strchr("-+ #0123456789.", *f) != nullptr && s < 24) {
+            spec[s++] = *f++;
+        }
+        while (*f != '\0' && strchr("hljztL", *f) != nullptr) {
+            ++f;
+        }
+        char type = *f;
+        if (type == '\0' || arg == record.arg_count) {
+            break;
+        }
+        ++f;
+        const LogArg& a = record.args[arg++];
+        long long as_signed = a.type == LogArg::Double ? (long long)a.d : a.type == LogArg::String ? 0 : a.i;
+        int written = 0;
+        switch (type) {
+        case 'd': case 'i':
+            spec[s++] = 'l'; spec[s++] = 'l'; spec[s++] = type; spec[s] = '\0';
+            written = snprintf(out + n, size - n, spec, as_signed);
+            break;
+        case 'c':
+            spec[s++] = 'c'; spec[s] = '\0';
+            written = snprintf(out + n, size - n, spec, (int)as_signed);
+            break;
+        case 'u': case 'x': case 'X': case 'o':
+            spec[s++] = 'l'; spec[s++] = 'l'; spec[s++] = type; spec[s] = '\0';
+            written = snprintf(out + n, size - n, spec, (unsigned long long)as_signed);
+            break;
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G':
+            spec[s++] = type; spec[s] = '\0';
+            written = snprintf(out + n, size - n, spec, a.type == LogArg::Double ? a.d :
+                               a.type == LogArg::Unsigned ? (double)a.u : (double)as_signed);
+            break;
+        case 's':
+            spec[s++] = 's'; spec[s] = '\0';
+            written = snprintf(out + n, size - n, spec, a.type == LogArg::String && a.s != nullptr ? a.s : "?");
+            break;
+        default:
+            break;
+        }
+        n += std::min((size_t)std::max(written, 0), size - 1 - n);
+    }
+    out[n] = '\0';
+    return n;
+}
+
+// Bounded multi-producer queue with a sequence number per cell (Vyukov),
+// drained by the logger thread.
+class AsyncLogger {
+public:
+    AsyncLogger(){
+        for (size_t i = 0; i < LogCapacity; ++i) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    ~AsyncLogger() { Stop(); }
+
+    void Start(){
+        stopping = false;
+        worker = std::thread(&AsyncLogger::Run, this);
+    }
+
+    // Writes what is queued, then returns.
+    void Stop(){
+        if (!worker.joinable()) {
+            return;
+        }
+        stopping = true;
+        worker.join();
+    }
+
+    unsigned long long dropped_count() const { return dropped.load(std::memory_order_relaxed); }
+
+    template <typename... Args>
+    void Write(LogLevel level, const char* format, Args... args){
+        static_assert(sizeof...(Args) <= MaxLogArgs, "too many log arguments");
+        LogRecord record;
+        record.format = format;
+        record.level = (uint8_t)level;
+        record.arg_count = (uint8_t)sizeof...(Args);
+        Fill(record.args, args...);
+        if (!TryPush(record)) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        LogRecord record;
+    };
+
+    static void Fill(LogArg*) {}
+
+    template <typename T, typename... Rest>
+    static void Fill(LogArg* out, T first, Rest... rest){
+        *out = MakeLogArg(first);
+        Fill(out + 1, rest...);
+    }
+
+    bool TryPush(const LogRecord& record){
+        size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+        Cell* cell;
+        for (;;) {
+            cell = &cells[pos & (LogCapacity - 1)];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            intptr_t difference = (intptr_t)sequence - (intptr_t)pos;
+            if (difference == 0) {
+                if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (difference < 0) {
+                return false; // full
+            } else {
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        cell->record = record;
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Logger thread only.
+    bool TryPop(LogRecord& record){
+        Cell& cell = cells[dequeue_pos & (LogCapacity - 1)];
+        if (cell.sequence.load(std::memory_order_acquire) != dequeue_pos + 1) {
+            return false;
+        }
+        record = cell.record;
+        cell.sequence.store(dequeue_pos + LogCapacity, std::memory_order_release);
+        dequeue_pos += 1;
+        return true;
+    }
+
+    void Run(){
+        char line[MaxLogLineLength];
+        unsigned long long reported_drops = 0;
+        std::chrono::steady_clock::time_point report_time = std::chrono::steady_clock::now();
+        LogRecord record;
+        for (;;) {
+            bool stop = stopping.load(std::memory_order_acquire);
+            while (TryPop(record)) {
+                FormatLogRecord(record, line, sizeof(line));
+                fputs(line, record.level >= LogWarning ? stderr : stdout);
+            }
+            // drops are reported once a second at most
+            unsigned long long drops = dropped_count();
+            std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+            if (drops != reported_drops && (stop || now - report_time >= std::chrono::seconds(1))) {
+                fprintf(stderr, "log: %llu records dropped, the ring was full\n", drops - reported_drops);
+                reported_drops = drops;
+                report_time = now;
+            }
+            fflush(stdout);
+            if (stop) {
+                return;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+    }
+
+    Cell cells[LogCapacity];
+    std::atomic<size_t> enqueue_pos{0};
+    size_t dequeue_pos = 0;
+    std::atomic<unsigned long long> dropped{0};
+    std::atomic<bool> stopping{false};
+    std::thread worker;
+};
+
+inline AsyncLogger& GetAsyncLogger(){
+    static AsyncLogger logger;
+    return logger;
+}
+
+#if LOG_LEVEL <= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) GetAsyncLogger().Write(LogDebug, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) ((void)0)
+#endif
+#if LOG_LEVEL <= LOG_LEVEL_INFO
+#define LOG_INFO(...) GetAsyncLogger().Write(LogInfo, __VA_ARGS__)
+#else
+#define LOG_INFO(...) ((void)0)
+#endif
+#if LOG_LEVEL <= LOG_LEVEL_WARNING
+#define LOG_WARNING(...) GetAsyncLogger().Write(LogWarning, __VA_ARGS__)
+#else
+#define LOG_WARNING(...) ((void)0)
+#endif
+#define LOG_ERROR(...) GetAsyncLogger().Write(LogError, __VA_ARGS__)
+
+#endif
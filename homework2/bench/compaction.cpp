@@ -0,0 +1,132 @@
+// Removing dead entities from a store laid out like ProjectileStore, up to
+// 1M entities: CompactStable and CompactUnordered against the erase per
+// entity they replaced, for several shares of dead entities. Erasing is
+// quadratic, it is only timed up to 100k entities.
+//
+//   g++ -O2 -std=c++11 -I.. -I<glm> compaction.cpp -o compaction
+
+#include "entity_pool.hpp"
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <random>
+#include <chrono>
+#include <cstdio>
+
+struct Store {
+    std::vector<glm::vec3> pos;
+    std::vector<glm::vec3> prev_pos;
+    std::vector<glm::vec3> direction;
+    std::vector<float> speed;
+    std::vector<float> collider_rad;
+    std::vector<uint8_t> life;
+    std::vector<uint8_t> out_of_range;
+    HandlePool handles;
+
+    void Fill(uint32_t count, const std::vector<uint8_t>& dead){
+        pos.assign(count, glm::vec3(1.0f));
+        prev_pos.assign(count, glm::vec3(1.0f));
+        direction.assign(count, glm::vec3(0.0f, 0.0f, -1.0f));
+        speed.assign(count, 15.0f);
+        collider_rad.assign(count, 0.5f);
+        life.resize(count);
+        for (uint32_t i = 0; i < count; ++i) {
+            life[i] = !dead[i];
+        }
+        out_of_range.assign(count, 0);
+        handles.Init(count);
+        for (uint32_t i = 0; i < count; ++i) {
+            handles.Acquire();
+        }
+    }
+
+    size_t size() const { return pos.size(); }
+
+    void Release(size_t i){
+        handles.Release(i);
+    }
+
+    void Move(size_t dst, size_t src){
+        pos[dst] = pos[src];
+        prev_pos[dst] = prev_pos[src];
+        direction[dst] = direction[src];
+        speed[dst] = speed[src];
+        collider_rad[dst] = collider_rad[src];
+        life[dst] = life[src];
+        out_of_range[dst] = out_of_range[src];
+        handles.Move(dst, src);
+    }
+
+    void Resize(size_t n){
+        pos.resize(n);
+        prev_pos.resize(n);
+        direction.resize(n);
+        speed.resize(n);
+        collider_rad.resize(n);
+        life.resize(n);
+        out_of_range.resize(n);
+        handles.Resize(n);
+    }
+
+    // What DeleteDestroyedObject did per dead entity, without the handles
+    // it didn't have.
+    void Erase(size_t i){
+        pos.erase(pos.begin() + i);
+        prev_pos.erase(prev_pos.begin() + i);
+        direction.erase(direction.begin() + i);
+        speed.erase(speed.begin() + i);
+        collider_rad.erase(collider_rad.begin() + i);
+        life.erase(life.begin() + i);
+        out_of_range.erase(out_of_range.begin() + i);
+    }
+};
+
+const int Runs = 3;
+
+// Best time of remove_dead over a freshly filled store, in ms.
+template <typename RemoveDead>
+double BestMilliseconds(Store& store, uint32_t count, const std::vector<uint8_t>& dead, RemoveDead remove_dead){
+    double best = 1e30;
+    for (int run = 0; run < Runs; ++run) {
+        store.Fill(count, dead);
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        remove_dead();
+        best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+int main(){
+    const uint32_t counts[] = {10000, 100000, 1000000};
+    const double dead_shares[] = {0.001, 0.01, 0.1, 0.5};
+    std::mt19937 random(9);
+    Store store;
+    printf("%8s %6s %12s %12s %12s\n", "entities", "dead", "erase ms", "stable ms", "unordered ms");
+    for (uint32_t count : counts) {
+        for (double share : dead_shares) {
+            std::bernoulli_distribution is_dead(share);
+            std::vector<uint8_t> dead(count);
+            for (uint8_t& d : dead) {
+                d = is_dead(random);
+            }
+            char erase_text[32] = "-";
+            if (count <= 100000) {
+                double ms = BestMilliseconds(store, count, dead, [&]() {
+                    for (size_t i = store.size(); i-- > 0;) {
+                        if (!store.life[i]) {
+                            store.Erase(i);
+                        }
+                    }
+                });
+                snprintf(erase_text, sizeof(erase_text), "%.2f", ms);
+            }
+            double stable = BestMilliseconds(store, count, dead, [&]() {
+                CompactStable(store, [&](size_t i) { return !store.life[i]; });
+            });
+            double unordered = BestMilliseconds(store, count, dead, [&]() {
+                CompactUnordered(store, [&](size_t i) { return !store.life[i]; });
+            });
+            printf("%8u %5.1f%% %12s %12.2f %12.2f\n", count, share * 100.0, erase_text, stable, unordered);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,186 @@
+// Entity update and instance upload per frame, 1k to 1M enemies and as
+// many projectiles: the structs homework2 stored them in before, Enemy and
+// Projectile on top of Object with pos, life and collider_rad declared
+// twice, against the arrays of EnemyStore and ProjectileStore. The update
+// is MoveProjectiles' step, the upload writes what the instance streams
+// get to a buffer standing in for the mapped stream buffer: the structs
+// are gathered field by field, the arrays are copied as they are. Both
+// layouts must end with the same positions and upload the same bytes, the
+// best of 10 frames is printed in ns per entity, enemies and projectiles
+// together.
+//
+//   g++ -O2 -std=c++11 -I.. -I<glm> entity_layout.cpp -o entity_layout
+
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cstring>
+#include <cstdint>
+#include <cstdio>
+
+using glm::vec3;
+using glm::vec4;
+
+const float DeltaTime = 1.0f / 60.0f;
+const int Frames = 10;
+
+// the structs before the structure of arrays
+struct Object {
+    vec3 pos;
+    bool life;
+    float collider_rad;
+};
+
+struct Enemy : Object {
+    vec3 pos;
+    bool life = true;
+    float collider_rad = 1.0f;
+    vec4 quaternion;
+    float dist;
+};
+
+struct Projectile : Object {
+    vec3 pos;
+    bool life = true;
+    float collider_rad = 0.25f * 2;
+    vec3 direction;
+    float speed = 15.0f;
+};
+
+// the fields of EnemyStore and ProjectileStore the frame touches, and the
+// ones it carries along
+struct Stores {
+    std::vector<vec3> enemy_pos;
+    std::vector<vec4> enemy_quaternion;
+    std::vector<float> enemy_collider_rad;
+    std::vector<uint8_t> enemy_life;
+    std::vector<vec3> pos;
+    std::vector<vec3> direction;
+    std::vector<float> speed;
+    std::vector<float> collider_rad;
+    std::vector<uint8_t> life;
+};
+
+struct Structs {
+    std::vector<Enemy> enemies;
+    std::vector<Projectile> projectiles;
+};
+
+// Enemy positions, quaternions and projectile positions, one after the
+// other like the three instance streams.
+struct UploadBuffer {
+    std::vector<uint8_t> bytes;
+
+    void Reserve(size_t count){
+        bytes.resize(count * (2 * sizeof(vec3) + sizeof(vec4)));
+    }
+
+    vec3* enemy_pos() { return (vec3*)bytes.data(); }
+    vec4* enemy_quaternion(size_t count) { return (vec4*)(bytes.data() + count * sizeof(vec3)); }
+    vec3* projectile_pos(size_t count) { return (vec3*)(bytes.data() + count * (sizeof(vec3) + sizeof(vec4))); }
+};
+
+void Fill(size_t count, Structs& structs, Stores& stores){
+    std::mt19937 random(3);
+    std::uniform_real_distribution<float> coordinate(-30.0f, 30.0f);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    structs.enemies.resize(count);
+    structs.projectiles.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        Enemy& enemy = structs.enemies[i];
+        enemy.pos = vec3(coordinate(random), coordinate(random), coordinate(random));
+        enemy.quaternion = glm::normalize(vec4(unit(random), unit(random), unit(random), unit(random)));
+        Projectile& proj = structs.projectiles[i];
+        proj.pos = vec3(coordinate(random), coordinate(random), coordinate(random));
+        proj.direction = glm::normalize(vec3(unit(random), unit(random), unit(random)) + vec3(0.0f, 0.0f, -2.0f));
+    }
+    stores = Stores();
+    for (const Enemy& enemy : structs.enemies) {
+        stores.enemy_pos.push_back(enemy.pos);
+        stores.enemy_quaternion.push_back(enemy.quaternion);
+        stores.enemy_collider_rad.push_back(enemy.collider_rad);
+        stores.enemy_life.push_back(enemy.life);
+    }
+    for (const Projectile& proj : structs.projectiles) {
+        stores.pos.push_back(proj.pos);
+        stores.direction.push_back(proj.direction);
+        stores.speed.push_back(proj.speed);
+        stores.collider_rad.push_back(proj.collider_rad);
+        stores.life.push_back(proj.life);
+    }
+}
+
+void UpdateStructs(Structs& structs){
+    for (Projectile& proj : structs.projectiles) {
+        proj.pos += proj.direction * (proj.speed * DeltaTime);
+    }
+}
+
+void UploadStructs(const Structs& structs, UploadBuffer& upload){
+    size_t n = structs.enemies.size();
+    vec3* enemy_pos = upload.enemy_pos();
+    vec4* enemy_quaternion = upload.enemy_quaternion(n);
+    vec3* projectile_pos = upload.projectile_pos(n);
+    for (size_t i = 0; i < n; ++i) {
+        enemy_pos[i] = structs.enemies[i].pos;
+        enemy_quaternion[i] = structs.enemies[i].quaternion;
+    }
+    for (size_t i = 0; i < structs.projectiles.size(); ++i) {
+        projectile_pos[i] = structs.projectiles[i].pos;
+    }
+}
+
+void UpdateStores(Stores& stores){
+    for (size_t i = 0; i < stores.pos.size(); ++i) {
+        stores.pos[i] += stores.direction[i] * (stores.speed[i] * DeltaTime);
+    }
+}
+
+void UploadStores(const Stores& stores, UploadBuffer& upload){
+    size_t n = stores.enemy_pos.size();
+    memcpy(upload.enemy_pos(), stores.enemy_pos.data(), n * sizeof(vec3));
+    memcpy(upload.enemy_quaternion(n), stores.enemy_quaternion.data(), n * sizeof(vec4));
+    memcpy(upload.projectile_pos(n), stores.pos.data(), stores.pos.size() * sizeof(vec3));
+}
+
+// Best ns per entity of update and of upload, over Frames frames.
+template <typename Update, typename Upload>
+void BestNanoseconds(size_t entities, Update update, Upload upload, double& update_ns, double& upload_ns){
+    update_ns = upload_ns = 1e30;
+    for (int frame = 0; frame < Frames; ++frame) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        update();
+        std::chrono::steady_clock::time_point moved = std::chrono::steady_clock::now();
+        upload();
+        std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+        update_ns = std::min(update_ns, std::chrono::duration<double, std::nano>(moved - start).count() / entities);
+        upload_ns = std::min(upload_ns, std::chrono::duration<double, std::nano>(end - moved).count() / entities);
+    }
+}
+
+int main(){
+    const size_t counts[] = {1000, 100000, 1000000};
+    printf("sizeof(Enemy) %zu, sizeof(Projectile) %zu bytes\n", sizeof(Enemy), sizeof(Projectile));
+    printf("%9s %14s %14s %14s %14s\n", "enemies", "structs update", "upload", "arrays update", "upload");
+    int failures = 0;
+    for (size_t count : counts) {
+        Structs structs;
+        Stores stores;
+        Fill(count, structs, stores);
+        UploadBuffer struct_upload, array_upload;
+        struct_upload.Reserve(count);
+        array_upload.Reserve(count);
+        double ns[4];
+        BestNanoseconds(2 * count, [&]() { UpdateStructs(structs); },
+                        [&]() { UploadStructs(structs, struct_upload); }, ns[0], ns[1]);
+        BestNanoseconds(2 * count, [&]() { UpdateStores(stores); },
+                        [&]() { UploadStores(stores, array_upload); }, ns[2], ns[3]);
+        bool same = struct_upload.bytes == array_upload.bytes;
+        printf("%9zu %14.2f %14.2f %14.2f %14.2f%s\n", count, ns[0], ns[1], ns[2], ns[3],
+               same ? "" : " MISMATCH");
+        failures += same ? 0 : 1;
+    }
+    return failures == 0 ? 0 : 1;
+}
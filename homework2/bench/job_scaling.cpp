@@ -0,0 +1,186 @@
+// Scaling of the frame phases homework2 runs on the job system, with 1M
+// projectiles and 10k enemies, on 1, 2, 4 ... threads up to the core
+// count or the count given: the projectile move with the kernel picked
+// for the CPU, the collision search on the enemy grid (CheckCollision's
+// parallel part, the grid built on the calling thread) and the culling
+// of the projectiles. Chunks are homework2's SimulationChunk. Every
+// thread count must give the same positions, hits and visible projectiles
+// as one thread, the best of 5 frames is printed in ms with the speedup
+// over one thread.
+//
+//   g++ -O2 -std=c++11 -pthread -I.. -I<glm> job_scaling.cpp -o job_scaling
+//   ./job_scaling [max threads]
+
+#include "job_system.hpp"
+#include "projectile_kernels.hpp"
+#include "collision_grid.hpp"
+#include "frustum.hpp"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <random>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+
+const size_t ProjectileCount = 1000000;
+const size_t EnemyCount = 10000;
+const size_t SimulationChunk = 4096;
+const float EnemyRadius = 1.0f;
+const float ProjectileRadius = 0.5f;
+const float MaxDistance = 35.0f;
+const float DeltaTime = 1.0f / 60.0f;
+const int Frames = 5;
+
+struct World {
+    std::vector<glm::vec3> pos;
+    std::vector<glm::vec3> prev_pos;
+    std::vector<glm::vec3> direction;
+    std::vector<float> speed;
+    std::vector<uint8_t> out_of_range;
+    std::vector<glm::vec3> enemy_pos;
+};
+
+struct Hit {
+    float toi;
+    int32_t enemy; // -1: none
+};
+
+World MakeWorld(){
+    World world;
+    std::mt19937 random(19);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> distance(0.0f, MaxDistance);
+    auto direction = [&]() {
+        glm::vec3 d;
+        do {
+            d = glm::vec3(unit(random), unit(random), unit(random));
+        } while (glm::dot(d, d) > 1.0f || glm::dot(d, d) < 1e-4f);
+        return glm::normalize(d);
+    };
+    for (size_t i = 0; i < ProjectileCount; ++i) {
+        glm::vec3 d = direction();
+        world.pos.push_back(d * distance(random));
+        world.direction.push_back(d);
+        world.speed.push_back(15.0f);
+    }
+    world.prev_pos = world.pos;
+    world.out_of_range.resize(ProjectileCount);
+    for (size_t i = 0; i < EnemyCount; ++i) {
+        world.enemy_pos.push_back(direction() * distance(random));
+    }
+    return world;
+}
+
+void Move(JobSystem& jobs, ProjectileKernel kernel, World& world){
+    jobs.ParallelFor(world.pos.size(), SimulationChunk, [&](size_t begin, size_t end) {
+        ProjectileArrays arrays = {world.pos.data() + begin, world.prev_pos.data() + begin, world.direction.data() + begin,
+                                   world.speed.data() + begin, world.out_of_range.data() + begin, end - begin};
+        kernel(arrays, DeltaTime, glm::vec3(0.0f), MaxDistance * MaxDistance);
+    });
+}
+
+void Collide(JobSystem& jobs, const World& world, UniformGrid& grid, std::vector<Hit>& hits){
+    grid.Build(world.enemy_pos.size(), 2.0f * EnemyRadius, [&](size_t i) { return world.enemy_pos[i]; });
+    hits.resize(world.pos.size());
+    glm::vec3 reach(ProjectileRadius + EnemyRadius);
+    jobs.ParallelFor(world.pos.size(), SimulationChunk, [&](size_t begin, size_t end) {
+        for (size_t p = begin; p < end; ++p) {
+            Hit hit = {0.0f, -1};
+            glm::vec3 lo = glm::min(world.prev_pos[p], world.pos[p]) - reach;
+            glm::vec3 hi = glm::max(world.prev_pos[p], world.pos[p]) + reach;
+            grid.Query(lo, hi, [&](uint32_t e) {
+                float toi;
+                if (SweptSphereHit(world.prev_pos[p], world.pos[p], world.enemy_pos[e], EnemyRadius + ProjectileRadius, toi) &&
+                    (hit.enemy < 0 || toi < hit.toi || (toi == hit.toi && (int32_t)e < hit.enemy))) {
+                    hit.toi = toi;
+                    hit.enemy = (int32_t)e;
+                }
+            });
+            hits[p] = hit;
+        }
+    });
+}
+
+struct Result {
+    double ms[3];
+    std::vector<glm::vec3> pos;
+    std::vector<Hit> hits;
+    std::vector<uint32_t> visible;
+};
+
+// Frames frames of every phase from the same start, best time of each.
+Result Run(int threads, ProjectileKernel kernel, const World& start, const Frustum& frustum){
+    JobSystem jobs;
+    jobs.Start(threads - 1);
+    Result result;
+    for (double& ms : result.ms) {
+        ms = 1e30;
+    }
+    World world;
+    UniformGrid grid;
+    grid.Reserve(EnemyCount);
+    std::vector<size_t> chunk_visible;
+    result.visible.resize(ProjectileCount);
+    size_t visible_count = 0;
+    for (int frame = 0; frame < Frames; ++frame) {
+        world = start;
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        Move(jobs, kernel, world);
+        std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+        Collide(jobs, world, grid, result.hits);
+        std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+        visible_count = ParallelCullSpheres(jobs, SimulationChunk, frustum, world.pos.data(), nullptr, world.pos.size(),
+                                            ProjectileRadius, result.visible.data(), chunk_visible);
+        std::chrono::steady_clock::time_point t3 = std::chrono::steady_clock::now();
+        result.ms[0] = std::min(result.ms[0], std::chrono::duration<double, std::milli>(t1 - t0).count());
+        result.ms[1] = std::min(result.ms[1], std::chrono::duration<double, std::milli>(t2 - t1).count());
+        result.ms[2] = std::min(result.ms[2], std::chrono::duration<double, std::milli>(t3 - t2).count());
+    }
+    jobs.Stop();
+    result.pos.swap(world.pos);
+    result.visible.resize(visible_count);
+    return result;
+}
+
+bool SameResult(const Result& a, const Result& b){
+    return memcmp(a.pos.data(), b.pos.data(), a.pos.size() * sizeof(glm::vec3)) == 0 &&
+           a.hits.size() == b.hits.size() &&
+           memcmp(a.hits.data(), b.hits.data(), a.hits.size() * sizeof(Hit)) == 0 &&
+           a.visible == b.visible;
+}
+
+int main(int argc, char* argv[]){
+    int max_threads = argc > 1 ? atoi(argv[1]) : (int)std::thread::hardware_concurrency();
+    max_threads = std::max(max_threads, 1);
+    std::vector<int> thread_counts;
+    for (int threads = 1; threads < max_threads; threads *= 2) {
+        thread_counts.push_back(threads);
+    }
+    thread_counts.push_back(max_threads);
+
+    const char* kernel_name;
+    ProjectileKernel kernel = SelectProjectileKernel(&kernel_name);
+    World world = MakeWorld();
+    // homework2's camera at the origin looking down -z
+    Frustum frustum = Frustum::FromMatrix(glm::perspective(glm::radians(45.0f), 4.0f / 3.0f, 0.1f, 100.0f));
+    printf("%zu projectiles, %zu enemies, %s kernel, %u cores\n", ProjectileCount, EnemyCount, kernel_name,
+           std::thread::hardware_concurrency());
+    printf("%7s %16s %16s %16s\n", "threads", "move ms", "collide ms", "cull ms");
+    Result one;
+    int failures = 0;
+    for (int threads : thread_counts) {
+        Result result = Run(threads, kernel, world, frustum);
+        if (threads == 1) {
+            one = result;
+        }
+        bool same = SameResult(result, one);
+        printf("%7d", threads);
+        for (int phase = 0; phase < 3; ++phase) {
+            printf(" %8.2f (%4.2fx)", result.ms[phase], one.ms[phase] / result.ms[phase]);
+        }
+        printf("%s\n", same ? "" : " MISMATCH");
+        failures += same ? 0 : 1;
+    }
+    return failures == 0 ? 0 : 1;
+}
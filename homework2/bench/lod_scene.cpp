@@ -0,0 +1,140 @@
+// Projectile triangles drawn with and without levels of detail, in a
+// scripted scene: a fixed camera, homework2's 1024x768 window and 45
+// degree field of view, fires shots into a 20 degree cone at the game's
+// speed and range, at the game's pace and at a load test pace. All shots
+// stay in view. The mesh is a UV sphere, or the .obj given.
+//
+//   g++ -O2 -std=c++11 -pthread -I.. -I<glm> lod_scene.cpp -o lod_scene
+//   ./lod_scene [sphera_v04.obj]
+
+#include "mesh_lod.hpp"
+#include "obj_loader.hpp"
+#include <random>
+#include <chrono>
+
+struct SceneVertex {
+    glm::vec3 position;
+    glm::vec2 uv;
+};
+
+const int LodCount = 4;
+const float LodPixels[LodCount - 1] = {64.0f, 32.0f, 16.0f}; // homework2's ProjectileLodPixels
+const float ShotSpeed = 15.0f;
+const float ShotRange = 35.0f;
+const float ConeHalfAngle = 10.0f * 3.14159265f / 180.0f;
+const int Frames = 600;
+const float FrameTime = 1.0f / 60.0f;
+
+std::vector<SceneVertex> SphereTriangles(int rings, int segments){
+    std::vector<SceneVertex> corners;
+    for (int r = 0; r < rings; ++r) {
+        for (int s = 0; s < segments; ++s) {
+            SceneVertex quad[4];
+            for (int k = 0; k < 4; ++k) {
+                float u = (float)(s + (k & 1)) / segments;
+                float v = (float)(r + (k >> 1)) / rings;
+                float theta = 3.14159265f * v, phi = 2.0f * 3.14159265f * u;
+                quad[k].position = glm::vec3(sinf(theta) * cosf(phi), cosf(theta), sinf(theta) * sinf(phi));
+                quad[k].uv = glm::vec2(u, v);
+            }
+            const int order[6] = {0, 2, 1, 1, 2, 3};
+            for (int k : order) {
+                corners.push_back(quad[k]);
+            }
+        }
+    }
+    return corners;
+}
+
+// Shots per frame fired for Frames frames; prints the triangles per frame.
+void RunScene(const char* name, int shots_per_frame, float radius, const std::vector<MeshLod>& lods){
+    const float pixels_per_unit = 1.0f / tanf(22.5f * 3.14159265f / 180.0f) * 768.0f * 0.5f;
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::vector<glm::vec3> pos, velocity;
+    double lod_triangles = 0.0, full_triangles = 0.0, shots = 0.0;
+    double level_shots[LodCount] = {};
+    double select_seconds = 0.0;
+    for (int frame = 0; frame < Frames; ++frame) {
+        for (int i = 0; i < shots_per_frame; ++i) {
+            // uniform in the cone around -z
+            float cos_angle = 1.0f - unit(random) * (1.0f - cosf(ConeHalfAngle));
+            float sin_angle = sqrtf(1.0f - cos_angle * cos_angle);
+            float around = 2.0f * 3.14159265f * unit(random);
+            pos.push_back(glm::vec3(0.0f));
+            velocity.push_back(glm::vec3(sin_angle * cosf(around), sin_angle * sinf(around), -cos_angle) * ShotSpeed);
+        }
+        for (size_t i = 0; i < pos.size();) {
+            pos[i] += velocity[i] * FrameTime;
+            if (glm::length(pos[i]) > ShotRange) {
+                pos[i] = pos.back();
+                velocity[i] = velocity.back();
+                pos.pop_back();
+                velocity.pop_back();
+            } else {
+                ++i;
+            }
+        }
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        size_t level_count[LodCount] = {};
+        for (const glm::vec3& p : pos) {
+            level_count[SelectLod(-p.z, radius, pixels_per_unit, LodPixels, (int)lods.size() - 1)] += 1;
+        }
+        select_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        for (size_t lod = 0; lod < lods.size(); ++lod) {
+            lod_triangles += (double)level_count[lod] * lods[lod].index_count / 3;
+            level_shots[lod] += (double)level_count[lod];
+        }
+        full_triangles += (double)pos.size() * lods[0].index_count / 3;
+        shots += (double)pos.size();
+    }
+    printf("%s: %.0f shots in view, %.0f triangles full, %.0f with LOD (%.1f%%), levels",
+           name, shots / Frames, full_triangles / Frames, lod_triangles / Frames,
+           100.0 * lod_triangles / std::max(full_triangles, 1.0));
+    for (size_t lod = 0; lod < lods.size(); ++lod) {
+        printf(" %.0f", level_shots[lod] / Frames);
+    }
+    printf(", %.1f ns/shot to select\n", select_seconds * 1e9 / std::max(shots, 1.0));
+}
+
+int main(int argc, char* argv[]){
+    std::vector<SceneVertex> triangles;
+    if (argc > 1) {
+        JobSystem jobs;
+        jobs.Start();
+        GetAsyncLogger().Start();
+        std::vector<glm::vec3> vertices, normals;
+        std::vector<glm::vec2> uvs;
+        if (!LoadOBJParallel(jobs, argv[1], vertices, uvs, normals) || vertices.empty()) {
+            GetAsyncLogger().Stop();
+            return 1;
+        }
+        GetAsyncLogger().Stop();
+        jobs.Stop();
+        triangles.resize(vertices.size());
+        for (size_t i = 0; i < vertices.size(); ++i) {
+            triangles[i].position = vertices[i];
+            triangles[i].uv = uvs[i];
+        }
+    } else {
+        triangles = SphereTriangles(32, 64);
+    }
+    IndexedMesh<SceneVertex> mesh = CookMesh(triangles);
+    IndexedMesh<SceneVertex> combined;
+    std::vector<MeshLod> lods;
+    BuildMeshLods(mesh, LodCount, combined, lods);
+    float radius = 0.0f;
+    for (const SceneVertex& vertex : mesh.vertices) {
+        radius = std::max(radius, glm::length(vertex.position));
+    }
+    printf("%s: radius %.2f, triangles per level", argc > 1 ? argv[1] : "UV sphere", radius);
+    for (const MeshLod& lod : lods) {
+        printf(" %u", lod.index_count / 3);
+    }
+    printf("\n");
+
+    RunScene("one shot a frame", 1, radius, lods);
+    RunScene("20 shots a frame", 20, radius, lods);
+    return 0;
+}
@@ -0,0 +1,51 @@
+// Time a logging call takes on the calling thread: LOG_INFO against
+// std::cout, buffered and flushed per line (what a terminal or a pipe
+// read by a terminal gets). The log lines go to stdout, the results to
+// stderr:
+//
+//   g++ -O2 -std=c++11 -pthread -I.. log_latency.cpp -o log_latency
+//   ./log_latency > /dev/null
+
+#include "async_log.hpp"
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+const int Calls = 20000;
+
+// About a frame loop's pace of log lines, the logger drains in between.
+const std::chrono::microseconds CallInterval(100);
+
+void PrintLatency(const char* name, std::vector<double> ns){
+    std::sort(ns.begin(), ns.end());
+    fprintf(stderr, "%-20s p50 %6.0f ns  p99 %6.0f ns  max %8.0f ns\n",
+            name, ns[ns.size() / 2], ns[ns.size() * 99 / 100], ns.back());
+}
+
+template <typename Call>
+std::vector<double> TimeCalls(Call call){
+    std::vector<double> ns(Calls);
+    for (int i = 0; i < Calls; ++i) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        call(i);
+        ns[i] = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        std::this_thread::sleep_for(CallInterval);
+    }
+    return ns;
+}
+
+int main(){
+    GetAsyncLogger().Start();
+    std::vector<double> async_log = TimeCalls([](int i) { LOG_INFO("create projectile %d\n", i); });
+    GetAsyncLogger().Stop();
+
+    std::vector<double> buffered = TimeCalls([](int i) { std::cout << "create projectile " << i << "\n"; });
+    std::cout << std::unitbuf;
+    std::vector<double> per_line = TimeCalls([](int i) { std::cout << "create projectile " << i << "\n"; });
+
+    PrintLatency("LOG_INFO", async_log);
+    PrintLatency("cout, buffered", buffered);
+    PrintLatency("cout, per line", per_line);
+    fprintf(stderr, "%llu records dropped\n", GetAsyncLogger().dropped_count());
+    return 0;
+}
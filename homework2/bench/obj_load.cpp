@@ -0,0 +1,118 @@
+// OBJ parse throughput: the scanf based loader against LoadOBJParallel on
+// the calling thread and on the job system, for a sphere of 2M triangles,
+// about 220 MB. Then startup the way LoadProjectileMesh does it: a cold
+// start parses and cooks the mesh, later ones map it from the mesh cache.
+// The cached mesh must be the cooked one byte for byte.
+//
+//   g++ -O2 -std=c++11 -pthread -I.. -I<glm> obj_load.cpp -o obj_load
+
+#include "obj_loader.hpp"
+#include "mesh_cache.hpp"
+#include "../tests/obj_reference.hpp"
+#include <chrono>
+
+const int Runs = 5;
+
+// homework2's ProjectileVertex
+struct MeshVertex {
+    glm::vec3 position;
+    glm::vec2 uv;
+};
+
+const char* const MeshLayout = "position:vec3 uv:vec2";
+
+// What LoadProjectileMesh does without a cache.
+bool ParseAndCook(JobSystem& jobs, const char* path, IndexedMesh<MeshVertex>& mesh, size_t& source_vertices){
+    std::vector<glm::vec3> vertices, normals;
+    std::vector<glm::vec2> uvs;
+    if (!LoadOBJParallel(jobs, path, vertices, uvs, normals)) {
+        return false;
+    }
+    std::vector<MeshVertex> triangles(vertices.size());
+    for (size_t i = 0; i < triangles.size(); ++i) {
+        triangles[i].position = vertices[i];
+        triangles[i].uv = uvs[i];
+    }
+    mesh = CookMesh(triangles);
+    source_vertices = triangles.size();
+    return true;
+}
+
+template <typename Load>
+void PrintStartup(const char* name, Load load){
+    double best = 1e30;
+    for (int run = 0; run < Runs; ++run) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        load();
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    printf("%-28s %7.1f ms\n", name, best * 1000.0);
+}
+
+template <typename Load>
+void PrintThroughput(const char* name, double megabytes, Load load){
+    double best = 1e30;
+    for (int run = 0; run < Runs; ++run) {
+        std::vector<glm::vec3> vertices, normals;
+        std::vector<glm::vec2> uvs;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        load(vertices, uvs, normals);
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    printf("%-28s %7.1f ms %7.1f MB/s\n", name, best * 1000.0, megabytes / best);
+}
+
+int main(){
+    const char* path = "obj_load.obj";
+    if (!WriteSphereOBJ(path, 1000, 1000)) {
+        printf("can't write %s\n", path);
+        return 1;
+    }
+    MappedFile file;
+    file.Open(path);
+    double megabytes = file.size() / 1e6;
+    file.Close();
+    printf("%s: %.1f MB\n", path, megabytes);
+
+    PrintThroughput("scanf", megabytes, [&](std::vector<glm::vec3>& v, std::vector<glm::vec2>& t, std::vector<glm::vec3>& n) {
+        ScanfLoadOBJ(path, v, t, n);
+    });
+    GetAsyncLogger().Start();
+    JobSystem inline_jobs;
+    inline_jobs.Start(0);
+    PrintThroughput("LoadOBJParallel, one thread", megabytes, [&](std::vector<glm::vec3>& v, std::vector<glm::vec2>& t, std::vector<glm::vec3>& n) {
+        LoadOBJParallel(inline_jobs, path, v, t, n);
+    });
+    JobSystem jobs;
+    jobs.Start();
+    char name[64];
+    snprintf(name, sizeof(name), "LoadOBJParallel, %d threads", jobs.thread_count());
+    PrintThroughput(name, megabytes, [&](std::vector<glm::vec3>& v, std::vector<glm::vec2>& t, std::vector<glm::vec3>& n) {
+        LoadOBJParallel(jobs, path, v, t, n);
+    });
+
+    IndexedMesh<MeshVertex> cooked, cached;
+    size_t source_vertices = 0;
+    PrintStartup("cold start: parse and cook", [&]() {
+        ParseAndCook(jobs, path, cooked, source_vertices);
+    });
+    MeshSource source;
+    if (!StatMeshSource(path, source) || !SaveMeshCache(path, MeshLayout, source, cooked, source_vertices)) {
+        printf("can't write the mesh cache\n");
+        return 1;
+    }
+    bool loaded = true;
+    PrintStartup("LoadMeshCache", [&]() {
+        loaded = loaded && StatMeshSource(path, source) &&
+                 LoadMeshCache(path, MeshLayout, source, cached, source_vertices);
+    });
+    bool same = loaded && cached.vertices.size() == cooked.vertices.size() && cached.indices == cooked.indices &&
+                memcmp(cached.vertices.data(), cooked.vertices.data(), cooked.vertices.size() * sizeof(MeshVertex)) == 0;
+    printf("%zu vertices, %zu triangles, cache %s\n", cooked.vertices.size(), cooked.indices.size() / 3,
+           same ? "matches" : "DIFFERS");
+    jobs.Stop();
+    GetAsyncLogger().Stop();
+    remove(MeshCachePath(path).c_str());
+    remove(path);
+    return same ? 0 : 1;
+}
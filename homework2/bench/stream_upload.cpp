@@ -0,0 +1,219 @@
+// Instance upload per frame, 10k to 1M enemy records, three ways of
+// streaming them in a real GL context without a window (egl_context.hpp):
+// StreamBuffer's persistent mapping, StreamBuffer's plain GL 3.3 path that
+// maps its region unsynchronized every frame, and orphaning, glBufferData
+// with no data then glBufferSubData from the records in memory. Every
+// frame draws the instances as points with rasterization off, so the
+// vertex stage reads each record. The average of Frames frames is printed:
+// CPU ms per frame, the record writes and the draw call with BeginFrame's
+// fence wait or the orphaning calls, and the upload bandwidth in MB/s
+// over all frames up to a final glFinish.
+// The last frame's records are read back and must match on every path.
+//
+//   g++ -O2 -std=c++11 -pthread -I.. -I<glm> -I<glew> stream_upload.cpp -o stream_upload -lGLEW -lEGL -lGL
+
+#include "../tests/egl_context.hpp"
+#include "stream_buffer.hpp"
+#include "instance_upload.hpp"
+#include <cstddef>
+#include <chrono>
+#include <cstring>
+
+using glm::vec3;
+using glm::vec4;
+
+const int Frames = 30;
+
+// homework2's enemy record
+struct EnemyInstance {
+    vec4 quaternion; // location 1
+    vec3 position;   // location 2
+};
+
+const char* const VertexShader =
+    "#version 330 core\n"
+    "layout(location = 1) in vec4 quaternion;\n"
+    "layout(location = 2) in vec3 position;\n"
+    "void main(){ gl_Position = vec4(position + quaternion.xyz, quaternion.w); }\n";
+const char* const FragmentShader =
+    "#version 330 core\n"
+    "out vec4 color;\n"
+    "void main(){ color = vec4(1.0); }\n";
+
+enum Path { Persistent, Unsynchronized, Orphaning };
+const char* const PathNames[3] = {"persistent", "unsynchronized", "orphaning"};
+
+void WriteRecords(EnemyInstance* records, size_t count, int frame){
+    for (size_t i = 0; i < count; ++i) {
+        float f = (float)(i + frame);
+        records[i].quaternion = vec4(0.0f, 0.0f, 0.0f, 1.0f);
+        records[i].position = vec3(f, f * 0.5f, -f);
+    }
+}
+
+void SetRecordPointers(GLintptr offset){
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(EnemyInstance),
+                          (void*)(offset + offsetof(EnemyInstance, quaternion)));
+    glVertexAttribDivisor(1, 1);
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(EnemyInstance),
+                          (void*)(offset + offsetof(EnemyInstance, position)));
+    glVertexAttribDivisor(2, 1);
+}
+
+struct Timing {
+    double cpu_ms;  // per frame
+    double mb_per_s;
+    std::vector<EnemyInstance> last; // read back after the last frame
+};
+
+Timing RunStream(size_t count){
+    StreamBuffer stream;
+    InstanceUpload<EnemyInstance> instances;
+    instances.Init("enemy instances", count, stream);
+    instances.AddAttribute<vec4>(1, offsetof(EnemyInstance, quaternion));
+    instances.AddAttribute<vec3>(2, offsetof(EnemyInstance, position));
+    stream.Init();
+    GLuint vao[StreamBuffer::Regions];
+    glGenVertexArrays(StreamBuffer::Regions, vao);
+    glBindBuffer(GL_ARRAY_BUFFER, stream.buffer());
+    for (int region = 0; region < StreamBuffer::Regions; ++region) {
+        glBindVertexArray(vao[region]);
+        instances.SetPointers(stream, region);
+    }
+
+    Timing timing;
+    double cpu_s = 0.0;
+    int last_region = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < Frames; ++frame) {
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        stream.BeginFrame();
+        if (EnemyInstance* records = instances.Begin(stream, count)) {
+            WriteRecords(records, count, frame);
+        }
+        if (!stream.Submit()) {
+            instances.Discard();
+        }
+        last_region = stream.region_index();
+        glBindVertexArray(vao[last_region]);
+        glDrawArraysInstanced(GL_POINTS, 0, 1, (GLsizei)instances.count());
+        stream.EndFrame();
+        cpu_s += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    }
+    glFinish();
+    double total_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    timing.cpu_ms = cpu_s * 1000.0 / Frames;
+    timing.mb_per_s = InstanceUpload<EnemyInstance>::Bytes(count) * (double)Frames / total_s / 1e6;
+
+    if (!stream.is_persistent()) {
+        timing.last.resize(count);
+        glBindBuffer(GL_ARRAY_BUFFER, stream.buffer());
+        glGetBufferSubData(GL_ARRAY_BUFFER, stream.Offset(last_region, 0), InstanceUpload<EnemyInstance>::Bytes(count),
+                           timing.last.data());
+    } else {
+        // the mapping stays, copy out through a buffer of its own
+        GLuint copy;
+        glGenBuffers(1, &copy);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, copy);
+        glBufferData(GL_COPY_WRITE_BUFFER, InstanceUpload<EnemyInstance>::Bytes(count), nullptr, GL_STATIC_READ);
+        glBindBuffer(GL_COPY_READ_BUFFER, stream.buffer());
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, stream.Offset(last_region, 0), 0,
+                            InstanceUpload<EnemyInstance>::Bytes(count));
+        timing.last.resize(count);
+        glGetBufferSubData(GL_COPY_WRITE_BUFFER, 0, InstanceUpload<EnemyInstance>::Bytes(count), timing.last.data());
+        glDeleteBuffers(1, &copy);
+    }
+    glDeleteVertexArrays(StreamBuffer::Regions, vao);
+    stream.Destroy();
+    return timing;
+}
+
+Timing RunOrphaning(size_t count){
+    GLuint buffer, vao;
+    glGenBuffers(1, &buffer);
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    GLsizeiptr bytes = InstanceUpload<EnemyInstance>::Bytes(count);
+    glBufferData(GL_ARRAY_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+    SetRecordPointers(0);
+
+    Timing timing;
+    std::vector<EnemyInstance> records(count);
+    double cpu_s = 0.0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < Frames; ++frame) {
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        WriteRecords(records.data(), count, frame);
+        glBufferData(GL_ARRAY_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, records.data());
+        glDrawArraysInstanced(GL_POINTS, 0, 1, (GLsizei)count);
+        cpu_s += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    }
+    glFinish();
+    double total_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    timing.cpu_ms = cpu_s * 1000.0 / Frames;
+    timing.mb_per_s = bytes * (double)Frames / total_s / 1e6;
+    timing.last.resize(count);
+    glGetBufferSubData(GL_ARRAY_BUFFER, 0, bytes, timing.last.data());
+    glDeleteVertexArrays(1, &vao);
+    glDeleteBuffers(1, &buffer);
+    return timing;
+}
+
+int main(){
+    if (!CreateHeadlessContext(false)) {
+        printf("no surfaceless GL 3.3 context\n");
+        return 1;
+    }
+    GetAsyncLogger().Start();
+    printf("%s, %s, %zu byte records\n", (const char*)glGetString(GL_RENDERER), (const char*)glGetString(GL_VERSION),
+           sizeof(EnemyInstance));
+    bool has_buffer_storage = GLEW_ARB_buffer_storage != 0;
+    GLuint program = CompileProgram(VertexShader, FragmentShader);
+    glUseProgram(program);
+    // there is no default framebuffer, the draws need a complete one
+    GLuint renderbuffer, framebuffer;
+    glGenRenderbuffers(1, &renderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, renderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, 1, 1);
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffer);
+    glEnable(GL_RASTERIZER_DISCARD);
+
+    const size_t counts[] = {10000, 100000, 1000000};
+    printf("%9s %16s %9s %10s\n", "instances", "path", "cpu ms", "MB/s");
+    int failures = 0;
+    for (size_t count : counts) {
+        Timing timings[3];
+        for (int path = Persistent; path <= Orphaning; ++path) {
+            if (path == Persistent && !has_buffer_storage) {
+                printf("%9zu %16s %9s %10s\n", count, PathNames[path], "-", "-");
+                continue;
+            }
+            // what GLEW_ARB_buffer_storage reads, StreamBuffer::Init picks the path by it
+            __GLEW_ARB_buffer_storage = path == Persistent ? GL_TRUE : GL_FALSE;
+            timings[path] = path == Orphaning ? RunOrphaning(count) : RunStream(count);
+            std::vector<EnemyInstance> expected(count);
+            WriteRecords(expected.data(), count, Frames - 1);
+            bool same = memcmp(timings[path].last.data(), expected.data(), count * sizeof(EnemyInstance)) == 0;
+            printf("%9zu %16s %9.3f %10.0f%s\n", count, PathNames[path], timings[path].cpu_ms, timings[path].mb_per_s,
+                   same ? "" : " MISMATCH");
+            failures += same ? 0 : 1;
+        }
+    }
+    __GLEW_ARB_buffer_storage = has_buffer_storage ? GL_TRUE : GL_FALSE;
+    GLenum error = glGetError();
+    if (error != GL_NO_ERROR) {
+        printf("GL error 0x%x\n", error);
+        ++failures;
+    }
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteRenderbuffers(1, &renderbuffer);
+    glDeleteProgram(program);
+    GetAsyncLogger().Stop();
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,76 @@
+// Enemies placed per second: the old CreateEnemy loop over rand(), one
+// at a time, against WaveSpawner on one thread and on the job system.
+//
+//   g++ -O2 -std=c++11 -pthread -I.. -I<glm> wave_spawn.cpp -o wave_spawn
+
+#include "job_system.hpp"
+#include "wave_spawner.hpp"
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+const size_t EnemyCount = 1000000;
+const int Runs = 5;
+
+// What CreateEnemy did per enemy before the wave spawner.
+void CreateEnemyWithRand(glm::vec3 camera_pos, std::vector<glm::vec3>& pos, std::vector<glm::vec4>& quaternion){
+    float w = rand() % 360;
+    glm::vec3 axis(rand() % 21 - 10, rand() % 21 - 10, rand() % 21 - 10);
+    glm::vec3 p(rand() % 21 - 10, rand() % 21 - 10, rand() % 21 - 10);
+    float radius = rand() % 20 + 12;
+    p = glm::normalize(p + camera_pos) * radius;
+    axis = glm::normalize(axis);
+    float half_angle = (w * 0.5f) * 3.14159f / 180.0f;
+    pos.push_back(p);
+    quaternion.push_back(glm::vec4(axis * sinf(half_angle), cosf(half_angle)));
+}
+
+template <typename Place>
+void PrintRate(const char* name, Place place){
+    double best = 1e30;
+    for (int run = 0; run < Runs; ++run) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        place();
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    printf("%-28s %7.1f M enemies/s\n", name, EnemyCount / best * 1e-6);
+}
+
+int main(){
+    const glm::vec3 camera_pos(1.0f, 2.0f, 3.0f);
+    std::vector<glm::vec3> pos;
+    std::vector<glm::vec4> quaternion;
+
+    PrintRate("rand(), one at a time", [&]() {
+        pos.clear();
+        quaternion.clear();
+        srand(42);
+        for (size_t i = 0; i < EnemyCount; ++i) {
+            CreateEnemyWithRand(camera_pos, pos, quaternion);
+        }
+    });
+
+    pos.resize(EnemyCount);
+    quaternion.resize(EnemyCount);
+    WaveSpawner spawner;
+    PrintRate("WaveSpawner, one thread", [&]() {
+        spawner.Seed(42);
+        spawner.Place(spawner.Take(EnemyCount), 0, EnemyCount, camera_pos, pos.data(), quaternion.data());
+    });
+
+    JobSystem jobs;
+    jobs.Start();
+    char name[64];
+    snprintf(name, sizeof(name), "WaveSpawner, %d threads", jobs.thread_count());
+    PrintRate(name, [&]() {
+        spawner.Seed(42);
+        uint64_t first = spawner.Take(EnemyCount);
+        jobs.ParallelFor(EnemyCount, 4096, [&](size_t begin, size_t end) {
+            spawner.Place(first, begin, end, camera_pos, pos.data(), quaternion.data());
+        });
+    });
+    jobs.Stop();
+    return 0;
+}
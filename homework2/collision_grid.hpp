@@ -0,0 +1,149 @@
+#ifndef COLLISION_GRID_HPP
+#define COLLISION_GRID_HPP
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+#include <cmath>
+
+// Uniform hash grid used as the collision broadphase.
+// Every item is bucketed by the cell that contains its center; the table is
+// rebuilt each frame with a counting sort, so there are no per-cell allocations.
+struct UniformGrid {
+    float cell_size = 1.0f;
+    uint32_t mask = 0;
+    std::vector<uint32_t> cell_start; // prefix sums, size = table size + 1
+    std::vector<uint32_t> items;      // item indices grouped by bucket
+    std::vector<uint32_t> item_bucket;
+
+    uint32_t Bucket(int x, int y, int z) const {
+        uint32_t h = (uint32_t(x) * 73856093u) ^ (uint32_t(y) * 19349663u) ^ (uint32_t(z) * 83492791u);
+        return h & mask;
+    }
+
+    int Cell(float v) const {
+        return (int)std::floor(v / cell_size);
+    }
+
+    static uint32_t TableSize(size_t count) {
+        uint32_t table_size = 64;
+        while (table_size < count * 2) {
+            table_size <<= 1;
+        }
+        return table_size;
+    }
+
+    // Reserve for up to count items so Build never allocates.
+    void Reserve(size_t count) {
+        cell_start.reserve(TableSize(count) + 1);
+        items.reserve(count);
+        item_bucket.reserve(count);
+    }
+
+    // get_pos(i) must return the center of item i
+    template <typename GetPos>
+    void Build(size_t count, float cell, GetPos get_pos) {
+        cell_size = cell;
+        uint32_t table_size = TableSize(count);
+        mask = table_size - 1;
+
+        cell_start.assign(table_size + 1, 0);
+        item_bucket.resize(count);
+        items.resize(count);
+
+        for (size_t i = 0; i < count; ++i) {
+            glm::vec3 p = get_pos(i);
+            uint32_t b = Bucket(Cell(p.x), Cell(p.y), Cell(p.z));
+            item_bucket[i] = b;
+            cell_start[b + 1] += 1;
+        }
+        for (uint32_t b = 0; b < table_size; ++b) {
+            cell_start[b + 1] += cell_start[b];
+        }
+        // fill using cell_start[b] as a cursor, then shift it back
+        for (size_t i = 0; i < count; ++i) {
+            items[cell_start[item_bucket[i]]++] = (uint32_t)i;
+        }
+        for (uint32_t b = table_size; b > 0; --b) {
+            cell_start[b] = cell_start[b - 1];
+        }
+        cell_start[0] = 0;
+    }
+
+    // Calls visit(i) for every item whose cell touches the box [lo, hi].
+    // Items of other cells sharing a bucket are reported too, so the caller
+    // still has to run the exact test.
+    template <typename Visit>
+    void Query(const glm::vec3& lo, const glm::vec3& hi, Visit visit) const {
+        if (items.empty()) {
+            return;
+        }
+        int x0 = Cell(lo.x), y0 = Cell(lo.y), z0 = Cell(lo.z);
+        int x1 = Cell(hi.x), y1 = Cell(hi.y), z1 = Cell(hi.z);
+        long long cells = (long long)(x1 - x0 + 1) * (y1 - y0 + 1) * (z1 - z0 + 1);
+
+        // a huge box covers the whole table anyway
+        if (cells > 64) {
+            for (uint32_t i : items) {
+                visit(i);
+            }
+            return;
+        }
+
+        // neighbouring cells can hash to the same bucket, visit each one once
+        uint32_t seen[64];
+        int seen_count = 0;
+        for (int x = x0; x <= x1; ++x) {
+            for (int y = y0; y <= y1; ++y) {
+                for (int z = z0; z <= z1; ++z) {
+                    uint32_t b = Bucket(x, y, z);
+                    bool repeated = false;
+                    for (int k = 0; k < seen_count; ++k) {
+                        if (seen[k] == b) {
+                            repeated = true;
+                            break;
+                        }
+                    }
+                    if (repeated) {
+                        continue;
+                    }
+                    seen[seen_count++] = b;
+                    for (uint32_t k = cell_start[b]; k < cell_start[b + 1]; ++k) {
+                        visit(items[k]);
+                    }
+                }
+            }
+        }
+    }
+};
+
+// The narrowphase: a sphere of radius rad moving from a to b against a
+// static point c. On hit writes the time of impact in [0, 1] along the
+// segment.
+inline bool SweptSphereHit(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, float rad, float& toi){
+    glm::vec3 m = a - c;
+    float c_ = glm::dot(m, m) - rad * rad;
+    if (c_ <= 0.0f) {
+        // already overlapping at the start of the step
+        toi = 0.0f;
+        return true;
+    }
+    glm::vec3 d = b - a;
+    float a_ = glm::dot(d, d);
+    float b_ = glm::dot(m, d);
+    if (a_ == 0.0f || b_ >= 0.0f) {
+        return false;
+    }
+    float disc = b_ * b_ - a_ * c_;
+    if (disc < 0.0f) {
+        return false;
+    }
+    float t = (-b_ - std::sqrt(disc)) / a_;
+    if (t > 1.0f) {
+        return false;
+    }
+    toi = t;
+    return true;
+}
+
+#endif
@@ -0,0 +1,112 @@
+#ifndef DDS_TEXTURE_HPP
+#define DDS_TEXTURE_HPP
+
+#include <GL/glew.h>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include "async_log.hpp"
+
+// The file side of common/texture's loadDDS: ReadDDS reads and checks the
+// file and touches no GL state, so it can run on a worker thread. The
+// texture is created from the image by the TextureStreamer.
+// Same formats as loadDDS: DXT1, DXT3 and DXT5 with their mip chain.
+
+struct DDSImage {
+    GLenum format = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t mip_count = 0;
+    std::vector<uint8_t> data; // all mip levels, largest first
+};
+
+inline uint32_t DDSBlockSize(GLenum format){
+    return format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT ? 8 : 16;
+}
+
+inline uint32_t DDSLevelSize(GLenum format, uint32_t width, uint32_t height){
+    return ((width + 3) / 4) * ((height + 3) / 4) * DDSBlockSize(format);
+}
+
+inline bool ReadDDS(const char* path, DDSImage& image){
+    FILE* f = fopen(path, "rb");
+    if (f == nullptr) {
+        LOG_ERROR("%s could not be opened. Are you in the right directory ? Don't forget to read the FAQ !\n", path);
+        return false;
+    }
+    char magic[4];
+    unsigned char header[124];
+    if (fread(magic, 1, 4, f) != 4 || strncmp(magic, "DDS ", 4) != 0 ||
+        fread(header, 1, sizeof(header), f) != sizeof(header)) {
+        LOG_ERROR("%s: not a DDS file\n", path);
+        fclose(f);
+        return false;
+    }
+    uint32_t mip_count;
+    char four_cc[4];
+    memcpy(&image.height, header + 8, 4);
+    memcpy(&image.width, header + 12, 4);
+    memcpy(&mip_count, header + 24, 4);
+    memcpy(four_cc, header + 80, 4);
+
+    if (strncmp(four_cc, "DXT1", 4) == 0) {
+        image.format = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+    } else if (strncmp(four_cc, "DXT3", 4) == 0) {
+        image.format = GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;
+    } else if (strncmp(four_cc, "DXT5", 4) == 0) {
+        image.format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    } else {
+        LOG_ERROR("%s: unsupported format\n", path);
+        fclose(f);
+        return false;
+    }
+
+    // the mip chain as far as the file holds it
+    if (mip_count == 0) {
+        mip_count = 1;
+    }
+    size_t total = 0;
+    uint32_t width = image.width;
+    uint32_t height = image.height;
+    image.mip_count = 0;
+    for (uint32_t level = 0; level < mip_count; ++level) {
+        total += DDSLevelSize(image.format, width, height);
+        image.mip_count += 1;
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+    }
+    image.data.resize(total);
+    size_t read = fread(image.data.data(), 1, total, f);
+    fclose(f);
+    if (read != total) {
+        LOG_ERROR("%s: truncated mip chain\n", path);
+        return false;
+    }
+    return true;
+}
+
+// Byte offset of a mip level in DDSImage::data.
+inline size_t DDSLevelOffset(const DDSImage& image, uint32_t level){
+    size_t offset = 0;
+    uint32_t width = image.width;
+    uint32_t height = image.height;
+    for (uint32_t i = 0; i < level; ++i) {
+        offset += DDSLevelSize(image.format, width, height);
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+    }
+    return offset;
+}
+
+inline uint32_t DDSLevelWidth(const DDSImage& image, uint32_t level){
+    uint32_t width = image.width >> level;
+    return width > 0 ? width : 1;
+}
+
+inline uint32_t DDSLevelHeight(const DDSImage& image, uint32_t level){
+    uint32_t height = image.height >> level;
+    return height > 0 ? height : 1;
+}
+
+#endif
@@ -0,0 +1,119 @@
+#ifndef DEPTH_SORT_HPP
+#define DEPTH_SORT_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+// Back-to-front ordering of an index array by per-frame depth keys, the
+// elements themselves never move. The order of the previous frame is the
+// starting point: with a smoothly moving camera it is nearly sorted and an
+// insertion sort finishes in about one pass. When the insertion sort has
+// to move too much (big camera jump, many new elements) it gives up and
+// the order is radix sorted on the key bits instead.
+
+// Float to uint32 with the same ordering, negative keys included.
+inline uint32_t SortableKey(float key){
+    uint32_t bits;
+    memcpy(&bits, &key, sizeof(bits));
+    return (bits & 0x80000000u) ? ~bits : bits | 0x80000000u;
+}
+
+// Sorts order by keys[order[i]], largest first, as long as it takes at
+// most max_moves element moves. Returns false if it gave up, order is
+// then a permutation in no particular order.
+inline bool InsertionSortDescending(std::vector<uint32_t>& order, const float* keys, size_t max_moves){
+    size_t moves = 0;
+    for (size_t i = 1; i < order.size(); ++i) {
+        uint32_t item = order[i];
+        float key = keys[item];
+        size_t j = i;
+        while (j > 0 && keys[order[j - 1]] < key) {
+            order[j] = order[j - 1];
+            --j;
+        }
+        order[j] = item;
+        moves += i - j;
+        if (moves > max_moves) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Stable LSD radix sort of order by keys[order[i]], largest first,
+// 3 passes of 11 bits. The scratch vectors are resized to order.size().
+inline void RadixSortDescending(std::vector<uint32_t>& order, const float* keys, std::vector<uint32_t>& tmp,
+                                std::vector<uint32_t>& sort_keys, std::vector<uint32_t>& tmp_keys){
+    const int Bits = 11;
+    const uint32_t Buckets = 1 << Bits;
+    size_t n = order.size();
+    tmp.resize(n);
+    sort_keys.resize(n);
+    tmp_keys.resize(n);
+    uint32_t count[3][Buckets];
+    memset(count, 0, sizeof(count));
+    for (size_t i = 0; i < n; ++i) {
+        // inverted, so ascending by sort key is descending by depth
+        uint32_t k = ~SortableKey(keys[order[i]]);
+        sort_keys[i] = k;
+        count[0][k & (Buckets - 1)] += 1;
+        count[1][(k >> Bits) & (Buckets - 1)] += 1;
+        count[2][k >> (2 * Bits)] += 1;
+    }
+    for (int pass = 0; pass < 3; ++pass) {
+        uint32_t sum = 0;
+        for (uint32_t b = 0; b < Buckets; ++b) {
+            uint32_t c = count[pass][b];
+            count[pass][b] = sum;
+            sum += c;
+        }
+    }
+    // the sort keys travel with the indices
+    uint32_t* src = order.data();
+    uint32_t* dst = tmp.data();
+    uint32_t* src_keys = sort_keys.data();
+    uint32_t* dst_keys = tmp_keys.data();
+    for (int pass = 0; pass < 3; ++pass) {
+        int shift = pass * Bits;
+        for (size_t i = 0; i < n; ++i) {
+            uint32_t at = count[pass][(src_keys[i] >> shift) & (Buckets - 1)]++;
+            dst[at] = src[i];
+            dst_keys[at] = src_keys[i];
+        }
+        std::swap(src, dst);
+        std::swap(src_keys, dst_keys);
+    }
+    // odd number of passes, the result is in tmp
+    if (src != order.data()) {
+        memcpy(order.data(), src, n * sizeof(uint32_t));
+    }
+}
+
+class DepthSorter {
+public:
+    void Reserve(size_t capacity){
+        tmp.reserve(capacity);
+        sort_keys.reserve(capacity);
+        tmp_keys.reserve(capacity);
+    }
+
+    // Sorts order by keys[order[i]], largest first. Returns true if it
+    // took the radix sort.
+    bool Sort(std::vector<uint32_t>& order, const float* keys){
+        // about two moves per element is still cheaper than a radix sort
+        if (InsertionSortDescending(order, keys, order.size() * 2 + 16)) {
+            return false;
+        }
+        RadixSortDescending(order, keys, tmp, sort_keys, tmp_keys);
+        return true;
+    }
+
+private:
+    std::vector<uint32_t> tmp;
+    std::vector<uint32_t> sort_keys;
+    std::vector<uint32_t> tmp_keys;
+};
+
+#endif
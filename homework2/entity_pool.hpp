@@ -0,0 +1,126 @@
+#ifndef ENTITY_POOL_HPP
+#define ENTITY_POOL_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Stable reference to an entity. It stays valid while the entity is moved
+// around in the dense arrays and goes stale once the entity is removed.
+struct EntityHandle {
+    uint32_t slot = UINT32_MAX;
+    uint32_t generation = 0;
+
+    EntityHandle() {}
+    EntityHandle(uint32_t s, uint32_t g) : slot(s), generation(g) {}
+};
+
+// Fixed-capacity slot table behind the dense entity arrays.
+// Slots are recycled through a free list and their generation is bumped on
+// release, so an old handle never resolves to the entity reusing its slot.
+// All memory is reserved in Init, nothing is allocated afterwards.
+class HandlePool {
+public:
+    void Init(uint32_t capacity){
+        generation.assign(capacity, 0);
+        dense_of.assign(capacity, UINT32_MAX);
+        free_slots.resize(capacity);
+        for (uint32_t i = 0; i < capacity; ++i) {
+            // pop order 0, 1, 2 ...
+            free_slots[i] = capacity - 1 - i;
+        }
+        slot_of.clear();
+        slot_of.reserve(capacity);
+    }
+
+    uint32_t capacity() const { return (uint32_t)generation.size(); }
+    bool full() const { return free_slots.empty(); }
+    uint32_t free_count() const { return (uint32_t)free_slots.size(); }
+
+    // Takes a slot for the element appended at the end of the dense arrays.
+    EntityHandle Acquire(){
+        uint32_t slot = free_slots.back();
+        free_slots.pop_back();
+        dense_of[slot] = (uint32_t)slot_of.size();
+        slot_of.push_back(slot);
+        return EntityHandle(slot, generation[slot]);
+    }
+
+    // Frees the slot of the dense element i, the element itself is
+    // overwritten or cut off by the caller.
+    void Release(uint32_t i){
+        uint32_t slot = slot_of[i];
+        generation[slot] += 1;
+        dense_of[slot] = UINT32_MAX;
+        free_slots.push_back(slot);
+    }
+
+    void Move(uint32_t dst, uint32_t src){
+        slot_of[dst] = slot_of[src];
+        dense_of[slot_of[dst]] = dst;
+    }
+
+    void Resize(uint32_t n){
+        slot_of.resize(n);
+    }
+
+    // Dense index of the entity, -1 if the handle is stale.
+    int Index(EntityHandle h) const {
+        if (h.slot >= generation.size() || generation[h.slot] != h.generation) {
+            return -1;
+        }
+        return (int)dense_of[h.slot];
+    }
+
+    EntityHandle Handle(uint32_t i) const {
+        return EntityHandle(slot_of[i], generation[slot_of[i]]);
+    }
+
+private:
+    std::vector<uint32_t> generation; // per slot
+    std::vector<uint32_t> dense_of;   // slot -> dense index
+    std::vector<uint32_t> free_slots;
+    std::vector<uint32_t> slot_of;    // dense index -> slot
+};
+
+// Single pass removal for the entity stores, remove(i) is asked once per
+// element. The store provides Release(i), Move(dst, src) and Resize(n).
+// CompactStable keeps the order of the survivors.
+template <typename Store, typename Pred>
+void CompactStable(Store& objects, Pred remove){
+    size_t n = objects.size();
+    size_t out = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (remove(i)) {
+            objects.Release(i);
+            continue;
+        }
+        if (out != i) {
+            objects.Move(out, i);
+        }
+        ++out;
+    }
+    objects.Resize(out);
+}
+
+// CompactUnordered fills every hole with the last element, so only the
+// removed elements cost a move.
+template <typename Store, typename Pred>
+void CompactUnordered(Store& objects, Pred remove){
+    size_t n = objects.size();
+    size_t i = 0;
+    while (i < n) {
+        if (remove(i)) {
+            objects.Release(i);
+            --n;
+            if (i != n) {
+                objects.Move(i, n);
+            }
+        } else {
+            ++i;
+        }
+    }
+    objects.Resize(n);
+}
+
+#endif
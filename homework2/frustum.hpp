@@ -0,0 +1,133 @@
+#ifndef FRUSTUM_HPP
+#define FRUSTUM_HPP
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+#include "job_system.hpp"
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FRUSTUM_SSE2
+#endif
+
+// View frustum as 6 planes (x, y, z, w), normals pointing inside and
+// normalized, so dot(plane.xyz, p) + plane.w is the signed distance of p.
+struct Frustum {
+    glm::vec4 planes[6];
+
+    // Planes of the clip volume of a model-view-projection matrix
+    // (Gribb/Hartmann), in the space the matrix transforms from.
+    static Frustum FromMatrix(const glm::mat4& m){
+        glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+        glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+        glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+        glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+        Frustum frustum;
+        frustum.planes[0] = row3 + row0; // left
+        frustum.planes[1] = row3 - row0; // right
+        frustum.planes[2] = row3 + row1; // bottom
+        frustum.planes[3] = row3 - row1; // top
+        frustum.planes[4] = row3 + row2; // near
+        frustum.planes[5] = row3 - row2; // far
+        for (int i = 0; i < 6; ++i) {
+            frustum.planes[i] /= glm::length(glm::vec3(frustum.planes[i]));
+        }
+        return frustum;
+    }
+
+    bool SphereVisible(const glm::vec3& center, float radius) const {
+        for (int i = 0; i < 6; ++i) {
+            const glm::vec4& p = planes[i];
+            if (p.x * center.x + p.y * center.y + p.z * center.z + p.w < -radius) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+// Writes to visible the indices of the spheres (positions[index], radius)
+// that touch the frustum, in input order, and returns how many there are.
+// indices may be nullptr for 0..count-1. With SSE2 four spheres are
+// tested against a plane at once.
+inline size_t CullSpheres(const Frustum& frustum, const glm::vec3* positions, const uint32_t* indices,
+                          size_t count, float radius, uint32_t* visible){
+    size_t n = 0;
+    size_t i = 0;
+#ifdef FRUSTUM_SSE2
+    __m128 plane_x[6], plane_y[6], plane_z[6], plane_w[6];
+    for (int k = 0; k < 6; ++k) {
+        plane_x[k] = _mm_set1_ps(frustum.planes[k].x);
+        plane_y[k] = _mm_set1_ps(frustum.planes[k].y);
+        plane_z[k] = _mm_set1_ps(frustum.planes[k].z);
+        plane_w[k] = _mm_set1_ps(frustum.planes[k].w);
+    }
+    __m128 min_distance = _mm_set1_ps(-radius);
+    for (; i + 4 <= count; i += 4) {
+        uint32_t index[4];
+        for (int j = 0; j < 4; ++j) {
+            index[j] = indices ? indices[i + j] : (uint32_t)(i + j);
+        }
+        const glm::vec3& a = positions[index[0]];
+        const glm::vec3& b = positions[index[1]];
+        const glm::vec3& c = positions[index[2]];
+        const glm::vec3& d = positions[index[3]];
+        __m128 x = _mm_setr_ps(a.x, b.x, c.x, d.x);
+        __m128 y = _mm_setr_ps(a.y, b.y, c.y, d.y);
+        __m128 z = _mm_setr_ps(a.z, b.z, c.z, d.z);
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (int k = 0; k < 6; ++k) {
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(plane_x[k], x), _mm_mul_ps(plane_y[k], y)),
+                                         _mm_add_ps(_mm_mul_ps(plane_z[k], z), plane_w[k]));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, min_distance));
+        }
+        int mask = _mm_movemask_ps(inside);
+        for (int j = 0; j < 4; ++j) {
+            visible[n] = index[j];
+            n += (mask >> j) & 1;
+        }
+    }
+#endif
+    for (; i < count; ++i) {
+        uint32_t index = indices ? indices[i] : (uint32_t)i;
+        if (frustum.SphereVisible(positions[index], radius)) {
+            visible[n++] = index;
+        }
+    }
+    return n;
+}
+
+// CullSpheres on the job system, same result. Every chunk writes its
+// visible indices where its input starts, they are moved together
+// afterwards. chunk_visible holds the count of each chunk.
+inline size_t ParallelCullSpheres(JobSystem& jobs, size_t min_chunk, const Frustum& frustum,
+                                  const glm::vec3* positions, const uint32_t* indices, size_t count,
+                                  float radius, uint32_t* visible, std::vector<size_t>& chunk_visible){
+    size_t chunk = jobs.ChunkSize(count, min_chunk);
+    chunk_visible.resize(jobs.ChunkCount(count, min_chunk));
+    jobs.ParallelFor(count, min_chunk, [&](size_t begin, size_t end) {
+        size_t n;
+        if (indices != nullptr) {
+            n = CullSpheres(frustum, positions, indices + begin, end - begin, radius, visible + begin);
+        } else {
+            // the chunk's indices are relative to its first sphere
+            n = CullSpheres(frustum, positions + begin, nullptr, end - begin, radius, visible + begin);
+            for (size_t i = 0; i < n; ++i) {
+                visible[begin + i] += (uint32_t)begin;
+            }
+        }
+        chunk_visible[begin / chunk] = n;
+    });
+    size_t n = 0;
+    for (size_t k = 0; k < chunk_visible.size(); ++k) {
+        if (n != k * chunk) {
+            memmove(visible + n, visible + k * chunk, chunk_visible[k] * sizeof(uint32_t));
+        }
+        n += chunk_visible[k];
+    }
+    return n;
+}
+
+#endif
@@ -0,0 +1,122 @@
+#ifndef GL_CALL_COUNTER_HPP
+#define GL_CALL_COUNTER_HPP
+
+#include <GL/glew.h>
+
+// Counts every GL call of the program. The entry points GLEW loads are
+// swapped for a trampoline that bumps the counter and calls the driver,
+// WrapGLFunctions() has to run right after glewInit. The GL 1.1 functions
+// (glClear, glBindTexture, ...) are exported by the GL library itself and
+// are called directly, so with COUNT_GL_CALLS defined before this header
+// they become macros that count at the call site; it has to be included
+// before any code calling them.
+// A GL function new to the program has to be added to one of the lists.
+
+inline unsigned long& GLCallCount(){
+    static unsigned long count = 0;
+    return count;
+}
+
+template <int Id, typename Ret, typename... Args>
+struct CountedGLFunction {
+    static Ret (GLAPIENTRY* driver)(Args...);
+
+    static Ret GLAPIENTRY Call(Args... args){
+        GLCallCount() += 1;
+        return driver(args...);
+    }
+};
+
+template <int Id, typename Ret, typename... Args>
+Ret (GLAPIENTRY* CountedGLFunction<Id, Ret, Args...>::driver)(Args...) = nullptr;
+
+template <int Id, typename Ret, typename... Args>
+void WrapGLFunction(Ret (GLAPIENTRY*& function)(Args...)){
+    if (function) {
+        CountedGLFunction<Id, Ret, Args...>::driver = function;
+        function = &CountedGLFunction<Id, Ret, Args...>::Call;
+    }
+}
+
+// Id only has to be unique per entry point, one wrap per line.
+#define WRAP_GL_FUNCTION(name) WrapGLFunction<__LINE__>(__glew##name)
+
+inline void WrapGLFunctions(){
+    WRAP_GL_FUNCTION(ActiveTexture);
+    WRAP_GL_FUNCTION(AttachShader);
+    WRAP_GL_FUNCTION(BeginQuery);
+    WRAP_GL_FUNCTION(BeginTransformFeedback);
+    WRAP_GL_FUNCTION(BindBuffer);
+    WRAP_GL_FUNCTION(BindBufferBase);
+    WRAP_GL_FUNCTION(BindVertexArray);
+    WRAP_GL_FUNCTION(BufferData);
+    WRAP_GL_FUNCTION(BufferStorage);
+    WRAP_GL_FUNCTION(BufferSubData);
+    WRAP_GL_FUNCTION(ClientWaitSync);
+    WRAP_GL_FUNCTION(CompileShader);
+    WRAP_GL_FUNCTION(CompressedTexImage2D);
+    WRAP_GL_FUNCTION(CreateProgram);
+    WRAP_GL_FUNCTION(CreateShader);
+    WRAP_GL_FUNCTION(DebugMessageCallback);
+    WRAP_GL_FUNCTION(DeleteBuffers);
+    WRAP_GL_FUNCTION(DeleteProgram);
+    WRAP_GL_FUNCTION(DeleteQueries);
+    WRAP_GL_FUNCTION(DeleteShader);
+    WRAP_GL_FUNCTION(DeleteSync);
+    WRAP_GL_FUNCTION(DeleteVertexArrays);
+    WRAP_GL_FUNCTION(DetachShader);
+    WRAP_GL_FUNCTION(DisableVertexAttribArray);
+    WRAP_GL_FUNCTION(DrawArraysInstanced);
+    WRAP_GL_FUNCTION(DrawElementsInstanced);
+    WRAP_GL_FUNCTION(EnableVertexAttribArray);
+    WRAP_GL_FUNCTION(EndQuery);
+    WRAP_GL_FUNCTION(EndTransformFeedback);
+    WRAP_GL_FUNCTION(FenceSync);
+    WRAP_GL_FUNCTION(GenBuffers);
+    WRAP_GL_FUNCTION(GenQueries);
+    WRAP_GL_FUNCTION(GenVertexArrays);
+    WRAP_GL_FUNCTION(GetBufferSubData);
+    WRAP_GL_FUNCTION(GetProgramBinary);
+    WRAP_GL_FUNCTION(GetProgramInfoLog);
+    WRAP_GL_FUNCTION(GetProgramiv);
+    WRAP_GL_FUNCTION(GetQueryObjectui64v);
+    WRAP_GL_FUNCTION(GetQueryObjectuiv);
+    WRAP_GL_FUNCTION(GetShaderInfoLog);
+    WRAP_GL_FUNCTION(GetShaderiv);
+    WRAP_GL_FUNCTION(GetUniformLocation);
+    WRAP_GL_FUNCTION(LinkProgram);
+    WRAP_GL_FUNCTION(MapBufferRange);
+    WRAP_GL_FUNCTION(ProgramBinary);
+    WRAP_GL_FUNCTION(ProgramParameteri);
+    WRAP_GL_FUNCTION(ShaderSource);
+    WRAP_GL_FUNCTION(TransformFeedbackVaryings);
+    WRAP_GL_FUNCTION(Uniform1f);
+    WRAP_GL_FUNCTION(Uniform1i);
+    WRAP_GL_FUNCTION(Uniform3f);
+    WRAP_GL_FUNCTION(UniformMatrix4fv);
+    WRAP_GL_FUNCTION(UnmapBuffer);
+    WRAP_GL_FUNCTION(UseProgram);
+    WRAP_GL_FUNCTION(VertexAttribDivisor);
+    WRAP_GL_FUNCTION(VertexAttribPointer);
+}
+
+// GL 1.1, counted where it is called
+#ifdef COUNT_GL_CALLS
+#define glBindTexture(...) (GLCallCount() += 1, glBindTexture(__VA_ARGS__))
+#define glClear(...) (GLCallCount() += 1, glClear(__VA_ARGS__))
+#define glClearColor(...) (GLCallCount() += 1, glClearColor(__VA_ARGS__))
+#define glDeleteTextures(...) (GLCallCount() += 1, glDeleteTextures(__VA_ARGS__))
+#define glDepthFunc(...) (GLCallCount() += 1, glDepthFunc(__VA_ARGS__))
+#define glDisable(...) (GLCallCount() += 1, glDisable(__VA_ARGS__))
+#define glDrawArrays(...) (GLCallCount() += 1, glDrawArrays(__VA_ARGS__))
+#define glEnable(...) (GLCallCount() += 1, glEnable(__VA_ARGS__))
+#define glGenTextures(...) (GLCallCount() += 1, glGenTextures(__VA_ARGS__))
+#define glGetError(...) (GLCallCount() += 1, glGetError(__VA_ARGS__))
+#define glGetIntegerv(...) (GLCallCount() += 1, glGetIntegerv(__VA_ARGS__))
+#define glGetString(...) (GLCallCount() += 1, glGetString(__VA_ARGS__))
+#define glPixelStorei(...) (GLCallCount() += 1, glPixelStorei(__VA_ARGS__))
+#define glTexImage2D(...) (GLCallCount() += 1, glTexImage2D(__VA_ARGS__))
+#define glTexParameteri(...) (GLCallCount() += 1, glTexParameteri(__VA_ARGS__))
+#endif
+
+#endif
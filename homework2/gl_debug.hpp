@@ -0,0 +1,24 @@
+#ifndef GL_DEBUG_HPP
+#define GL_DEBUG_HPP
+
+#include <GL/glew.h>
+#include <cstdio>
+
+// Debug output of a debug context (KHR_debug). Errors and high severity
+// messages are printed to stderr from inside the GL call that raised them,
+// so a debugger stopped in the callback shows the offending call.
+
+inline void APIENTRY PrintGLDebugMessage(GLenum, GLenum type, GLuint, GLenum severity,
+                                         GLsizei, const GLchar* message, const void*){
+    if (type == GL_DEBUG_TYPE_ERROR || severity == GL_DEBUG_SEVERITY_HIGH) {
+        fprintf(stderr, "GL error: %s\n", message);
+    }
+}
+
+// The context must have KHR_debug.
+inline void EnableGLDebugOutput(){
+    glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+    glDebugMessageCallback(PrintGLDebugMessage, nullptr);
+}
+
+#endif
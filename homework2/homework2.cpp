@@ -14,131 +14,1173 @@ GLFWwindow* window;
 #include <glm/gtc/matrix_transform.hpp>
 using namespace glm;
 
-#include <common/shader.hpp>
 #include <common/controls.hpp>
 #include <glm/gtc/quaternion.hpp>
 #include <algorithm>
 #include <vector>
 #include <ctime>
-#include <iostream>
 #include <common/objloader.hpp>
 #include <common/texture.hpp>
 
-struct Object{
-    vec3 pos;
-    bool life;
-    float collider_rad;
-};
+// Define COUNT_GL_CALLS to print the number of GL calls per frame
+// #define COUNT_GL_CALLS
+#include "gl_call_counter.hpp"
+
+#include "collision_grid.hpp"
+#include "entity_pool.hpp"
+#include "gl_debug.hpp"
+#include "stream_buffer.hpp"
+#include "instance_upload.hpp"
+#include "mesh_cooker.hpp"
+#include "mesh_cache.hpp"
+#include "obj_loader.hpp"
+#include "dds_texture.hpp"
+#include "asset_loader.hpp"
+#include "texture_streamer.hpp"
+#include "depth_sort.hpp"
+#include "frustum.hpp"
+#include "projectile_feedback.hpp"
+#include "mesh_lod.hpp"
+#include "projectile_kernels.hpp"
+#include "job_system.hpp"
+#include "input_log.hpp"
+#include "wave_spawner.hpp"
+#include "async_log.hpp"
+#include "../common/shader_cache.hpp"
+#include <memory>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+
+#ifndef NDEBUG
+#define TRACK_HEAP_ALLOCATIONS
+#endif
+
+// Define ENABLE_PROFILER to time the phases of the frame and the
+// simulation step on the CPU and the draws on the GPU. Prints p50/p99 per
+// scope every second and writes frame_trace.json for chrome://tracing on
+// exit.
+// #define ENABLE_PROFILER
+#include "profiler.hpp"
+
+// Define REPORT_CULLING to print the visible instances and projectile
+// triangles per frame
+// #define REPORT_CULLING
+
+#ifdef TRACK_HEAP_ALLOCATIONS
+#include <atomic>
+#include <new>
+
+// Debug builds count heap allocations, the frame loop reports every frame
+// that allocates once the entity pools are set up.
+std::atomic<size_t> heapAllocationCount(0);
+
+// Every form of new is replaced together with its delete, all on
+// malloc/free, so no pointer is freed by a different allocator. free is
+// kept out of line: inlined into a caller of the library's new, gcc would
+// take it for a mismatched pair (-Wmismatched-new-delete).
+#ifdef __GNUC__
+#define HEAP_NOINLINE __attribute__((noinline))
+#else
+#define HEAP_NOINLINE
+#endif
+
+void* CountedMalloc(size_t size) noexcept {
+    heapAllocationCount.fetch_add(1, std::memory_order_relaxed);
+    return malloc(size ? size : 1);
+}
+
+HEAP_NOINLINE void HeapFree(void* p) noexcept { free(p); }
+
+void* operator new(size_t size){
+    if (void* p = CountedMalloc(size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size){
+    if (void* p = CountedMalloc(size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return CountedMalloc(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return CountedMalloc(size); }
+
+void operator delete(void* p) noexcept { HeapFree(p); }
+void operator delete[](void* p) noexcept { HeapFree(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { HeapFree(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { HeapFree(p); }
+void operator delete(void* p, size_t) noexcept { HeapFree(p); }
+void operator delete[](void* p, size_t) noexcept { HeapFree(p); }
+
+#ifdef __cpp_aligned_new
+// over-aligned types, C++17 builds only
+void* CountedAlignedMalloc(size_t size, std::align_val_t alignment) noexcept {
+    heapAllocationCount.fetch_add(1, std::memory_order_relaxed);
+    size_t a = (size_t)alignment;
+#ifdef _MSC_VER
+    return _aligned_malloc(size ? size : 1, a);
+#else
+    return aligned_alloc(a, (size + a - 1) / a * a + (size ? 0 : a));
+#endif
+}
+
+HEAP_NOINLINE void AlignedFree(void* p) noexcept {
+#ifdef _MSC_VER
+    _aligned_free(p);
+#else
+    free(p);
+#endif
+}
+
+void* operator new(size_t size, std::align_val_t alignment){
+    if (void* p = CountedAlignedMalloc(size, alignment)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size, std::align_val_t alignment){
+    if (void* p = CountedAlignedMalloc(size, alignment)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return CountedAlignedMalloc(size, alignment);
+}
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return CountedAlignedMalloc(size, alignment);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept { AlignedFree(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { AlignedFree(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { AlignedFree(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { AlignedFree(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { AlignedFree(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { AlignedFree(p); }
+#endif
+#endif
+
+// Enemies are stored as a structure of arrays: the hot loops only touch the
+// fields they need, and pos/quaternion go to the instance buffers as they are.
+// The arrays are reserved to a fixed capacity in Init and never grow after it.
+struct EnemyStore {
+    std::vector<vec3> pos;
+    std::vector<vec4> quaternion;
+    std::vector<float> collider_rad;
+    std::vector<uint8_t> life;
+    HandlePool handles;
+
+    void Init(uint32_t capacity){
+        pos.reserve(capacity);
+        quaternion.reserve(capacity);
+        collider_rad.reserve(capacity);
+        life.reserve(capacity);
+        handles.Init(capacity);
+    }
+
+    size_t size() const { return pos.size(); }
+    bool full() const { return handles.full(); }
+
+    // Appends up to count enemies, as many as there is room for, and
+    // returns how many. Their pos and quaternion are left for the caller.
+    size_t AddBatch(size_t count){
+        count = std::min(count, (size_t)handles.free_count());
+        size_t n = size() + count;
+        pos.resize(n);
+        quaternion.resize(n);
+        collider_rad.resize(n, 1.0f);
+        life.resize(n, true);
+        for (size_t i = 0; i < count; ++i) {
+            handles.Acquire();
+        }
+        return count;
+    }
 
-// CPU representation of a particle
-struct Enemy : Object{
-    vec3 pos;
-    bool life = true;
-    float collider_rad = 1.0f;
-    vec4 quaternion;
-    float dist;
+    void Release(size_t i){
+        handles.Release(i);
+    }
 
-    bool operator<(const Enemy& that) const {
-        // Sort in reverse order : far particles drawn first.
-        return this->dist > that.dist;
+    void Move(size_t dst, size_t src){
+        pos[dst] = pos[src];
+        quaternion[dst] = quaternion[src];
+        collider_rad[dst] = collider_rad[src];
+        life[dst] = life[src];
+        handles.Move(dst, src);
     }
 
-    Enemy(vec3 p, vec3 axis, float angle) : pos(p){
-        float half_angle = (angle * 0.5) * 3.14159 / 180.0;
-        quaternion.x = axis.x * sin(half_angle);
-        quaternion.y = axis.y * sin(half_angle);
-        quaternion.z = axis.z * sin(half_angle);
-        quaternion.w = cos(half_angle);
-        vec3 cam_pos = getCameraPosition();
-        dist = distance(pos, cam_pos);
+    void Resize(size_t n){
+        pos.resize(n);
+        quaternion.resize(n);
+        collider_rad.resize(n);
+        life.resize(n);
+        handles.Resize(n);
     }
 };
 
-struct Projectile : Object{
-    vec3 pos;
-    bool life = true;
-    float collider_rad = 0.25f * 2;
-    vec3 direction;
-    float speed = 15.0f;
+struct ProjectileStore {
+    std::vector<vec3> pos;
+    std::vector<vec3> prev_pos; // position before the last move, start of the swept test
+    std::vector<vec3> direction;
+    std::vector<float> speed;
+    std::vector<float> collider_rad;
+    std::vector<uint8_t> life;
+    std::vector<uint8_t> out_of_range; // set by MoveProjectiles
+    HandlePool handles;
+
+    void Init(uint32_t capacity){
+        pos.reserve(capacity);
+        prev_pos.reserve(capacity);
+        direction.reserve(capacity);
+        speed.reserve(capacity);
+        collider_rad.reserve(capacity);
+        life.reserve(capacity);
+        out_of_range.reserve(capacity);
+        handles.Init(capacity);
+    }
+
+    size_t size() const { return pos.size(); }
+    bool full() const { return handles.full(); }
 
-    explicit Projectile(vec3 p, vec3 dir) : pos(p), direction(dir) {}
+    // Returns a stale handle when the store is full.
+    EntityHandle Add(vec3 p, vec3 dir){
+        if (full()) {
+            return EntityHandle();
+        }
+        pos.push_back(p);
+        prev_pos.push_back(p);
+        direction.push_back(dir);
+        speed.push_back(15.0f);
+        collider_rad.push_back(0.25f * 2);
+        life.push_back(true);
+        out_of_range.push_back(false);
+        return handles.Acquire();
+    }
+
+    void Release(size_t i){
+        handles.Release(i);
+    }
+
+    void Move(size_t dst, size_t src){
+        pos[dst] = pos[src];
+        prev_pos[dst] = prev_pos[src];
+        direction[dst] = direction[src];
+        speed[dst] = speed[src];
+        collider_rad[dst] = collider_rad[src];
+        life[dst] = life[src];
+        out_of_range[dst] = out_of_range[src];
+        handles.Move(dst, src);
+    }
+
+    void Resize(size_t n){
+        pos.resize(n);
+        prev_pos.resize(n);
+        direction.resize(n);
+        speed.resize(n);
+        collider_rad.resize(n);
+        life.resize(n);
+        out_of_range.resize(n);
+        handles.Resize(n);
+    }
 };
 
 const int MaxEnemies = 20;
 const int MaxProjectiles = 50;
-std::vector<Enemy> enemyContainer;
+EnemyStore enemyContainer;
 GLint KilledEnemyCount = 0;
-std::vector<Projectile> projectileContainer;
+ProjectileStore projectileContainer;
+
+const float MaxProjectileDistance = 35.0f;
+
+// The entity state the simulation thread publishes after its steps.
+// Projectiles keep their position before the last step too, to be
+// interpolated. Enemies don't move.
+struct SimulationSnapshot {
+    uint64_t tick = 0;
+    double time = 0.0; // glfwGetTime() the tick belongs to
+    std::vector<vec3> enemy_pos;
+    std::vector<vec4> enemy_quaternion;
+    std::vector<EntityHandle> enemy_handle;
+    std::vector<vec3> projectile_prev_pos;
+    std::vector<vec3> projectile_pos;
+    std::vector<uint32_t> projectile_slot;
+
+    void Reserve(){
+        enemy_pos.reserve(MaxEnemies);
+        enemy_quaternion.reserve(MaxEnemies);
+        enemy_handle.reserve(MaxEnemies);
+        projectile_prev_pos.reserve(MaxProjectiles);
+        projectile_pos.reserve(MaxProjectiles);
+        projectile_slot.reserve(MaxProjectiles);
+    }
+
+    // Simulation thread, from the stores.
+    void Capture(uint64_t at_tick, double at_time){
+        tick = at_tick;
+        time = at_time;
+        enemy_pos.assign(enemyContainer.pos.begin(), enemyContainer.pos.end());
+        enemy_quaternion.assign(enemyContainer.quaternion.begin(), enemyContainer.quaternion.end());
+        enemy_handle.resize(enemyContainer.size());
+        for (size_t i = 0; i < enemyContainer.size(); ++i) {
+            enemy_handle[i] = enemyContainer.handles.Handle(i);
+        }
+        projectile_prev_pos.assign(projectileContainer.prev_pos.begin(), projectileContainer.prev_pos.end());
+        projectile_pos.assign(projectileContainer.pos.begin(), projectileContainer.pos.end());
+        projectile_slot.resize(projectileContainer.size());
+        for (size_t i = 0; i < projectileContainer.size(); ++i) {
+            projectile_slot[i] = projectileContainer.handles.Handle(i).slot;
+        }
+    }
+};
+
+// What the render thread draws this frame, copied from the latest snapshot.
+struct DrawState {
+    std::vector<vec3> enemy_pos;
+    std::vector<vec4> enemy_quaternion;
+    std::vector<EntityHandle> enemy_handle;
+    std::vector<int> enemy_index_of_slot; // -1: no enemy
+    std::vector<vec3> projectile_pos;      // interpolated
+    std::vector<vec3> projectile_tick_pos; // at the snapshot's tick
+    std::vector<uint32_t> projectile_slot;
+
+    void Reserve(){
+        enemy_pos.reserve(MaxEnemies);
+        enemy_quaternion.reserve(MaxEnemies);
+        enemy_handle.reserve(MaxEnemies);
+        enemy_index_of_slot.resize(MaxEnemies);
+        projectile_pos.reserve(MaxProjectiles);
+        projectile_tick_pos.reserve(MaxProjectiles);
+        projectile_slot.reserve(MaxProjectiles);
+    }
+
+    // alpha 0 is the state before the snapshot's tick, 1 at it.
+    void Copy(const SimulationSnapshot& snapshot, float alpha){
+        enemy_pos = snapshot.enemy_pos;
+        enemy_quaternion = snapshot.enemy_quaternion;
+        enemy_handle = snapshot.enemy_handle;
+        std::fill(enemy_index_of_slot.begin(), enemy_index_of_slot.end(), -1);
+        for (size_t i = 0; i < enemy_handle.size(); ++i) {
+            enemy_index_of_slot[enemy_handle[i].slot] = (int)i;
+        }
+        size_t n = snapshot.projectile_pos.size();
+        projectile_pos.resize(n);
+        for (size_t i = 0; i < n; ++i) {
+            projectile_pos[i] = mix(snapshot.projectile_prev_pos[i], snapshot.projectile_pos[i], alpha);
+        }
+        projectile_tick_pos = snapshot.projectile_pos;
+        projectile_slot = snapshot.projectile_slot;
+    }
 
-void MoveProjectiles(float delta_time){
-    for (Projectile& proj : projectileContainer){
-        proj.pos += proj.direction * proj.speed * (float)delta_time;
+    // Index of the enemy in this frame, -1 if it is gone.
+    int EnemyIndex(EntityHandle h) const {
+        if (h.slot >= enemy_index_of_slot.size()) {
+            return -1;
+        }
+        int i = enemy_index_of_slot[h.slot];
+        return i >= 0 && enemy_handle[i].generation == h.generation ? i : -1;
     }
+};
+
+DrawState drawState;
+
+// Worker threads of the simulation phases. The phases are split in chunks
+// of at least SimulationChunk entities, smaller ones run on the main thread.
+JobSystem jobs;
+const size_t SimulationChunk = 4096;
+
+// SIMD kernel picked for the CPU at startup (projectile_kernels.hpp)
+ProjectileKernel moveProjectilesKernel = MoveProjectilesScalar;
+
+// Also flags the projectiles that went out of range of the camera, they
+// are removed with the dead ones.
+void MoveProjectiles(float delta_time, vec3 camera){
+    ProjectileStore& proj = projectileContainer;
+    float max_distance2 = MaxProjectileDistance * MaxProjectileDistance;
+    jobs.ParallelFor(proj.size(), SimulationChunk, [&proj, delta_time, camera, max_distance2](size_t begin, size_t end) {
+        ProjectileArrays arrays = {proj.pos.data() + begin, proj.prev_pos.data() + begin, proj.direction.data() + begin,
+                                   proj.speed.data() + begin, proj.out_of_range.data() + begin, end - begin};
+        moveProjectilesKernel(arrays, delta_time, camera, max_distance2);
+    });
 }
 
-void CheckCollision(){
-    for (Projectile& proj : projectileContainer){
-        if(!proj.life){
-            continue;
+// true: projectiles are drawn from state moved on the GPU with transform
+// feedback (projectile_feedback.hpp) instead of positions uploaded every
+// frame. That upload is all it saves: the CPU still moves every projectile
+// every step, collisions and removal need the positions. Debug builds
+// compare both once a second.
+const bool SimulateProjectilesOnGPU = false;
+bool projectilesOnGPU = false; // SimulateProjectilesOnGPU and the shader loaded
+ProjectileFeedback projectileFeedback;
+
+// The simulation records its projectile feedback calls in order, the GL
+// thread replays them (one Step per simulation step).
+struct FeedbackEvent {
+    enum Type { Step, Spawn, Kill };
+    Type type;
+    uint32_t slot;
+    vec3 position; // Step: camera position
+    vec3 velocity;
+};
+std::vector<FeedbackEvent> feedbackEvents; // simulation thread, since the last snapshot
+
+#ifndef NDEBUG
+std::vector<ProjectileFeedback::Record> feedbackReadback;
+
+// Stalls on the readback, every projectile of the snapshot has to be
+// where the CPU has it.
+void CheckProjectileFeedback(){
+    projectileFeedback.Read(feedbackReadback);
+    const std::vector<vec3>& pos = drawState.projectile_tick_pos;
+    size_t mismatches = 0;
+    for (size_t i = 0; i < pos.size(); ++i) {
+        const ProjectileFeedback::Record& record = feedbackReadback[drawState.projectile_slot[i]];
+        float tolerance = 1e-4f * (1.0f + length(pos[i]));
+        vec3 d = vec3(record.position) - pos[i];
+        if (record.position.w != 0.0f && dot(d, d) > tolerance * tolerance) {
+            mismatches += 1;
         }
-        for (Enemy& enemy : enemyContainer){
-            if(!enemy.life){
-                continue;
+    }
+    if (mismatches != 0) {
+        fprintf(stderr, "projectile feedback: %zu of %zu projectiles off the CPU positions\n", mismatches, pos.size());
+    }
+}
+#endif
+
+// false: check every projectile against every enemy (reference path)
+const bool UseCollisionGrid = true;
+UniformGrid enemyGrid;
+
+struct CollisionHit {
+    float toi;
+    int proj;
+    int enemy;
+
+    bool operator<(const CollisionHit& that) const {
+        if (toi != that.toi) return toi < that.toi;
+        if (proj != that.proj) return proj < that.proj;
+        return enemy < that.enemy;
+    }
+};
+std::vector<CollisionHit> collisionHits;
+std::vector<CollisionHit> projectileHit; // earliest hit of each projectile
+std::vector<uint8_t> projectileHasHit;
+
+// Earliest hit of projectile p among the live enemies, false if there is none.
+bool EarliestHit(int p, float max_enemy_rad, CollisionHit& hit){
+    const ProjectileStore& proj = projectileContainer;
+    const EnemyStore& enemy = enemyContainer;
+    bool found = false;
+    auto test = [&](uint32_t e) {
+        float toi;
+        if (enemy.life[e] && SweptSphereHit(proj.prev_pos[p], proj.pos[p], enemy.pos[e], enemy.collider_rad[e] + proj.collider_rad[p], toi)) {
+            CollisionHit candidate = {toi, p, (int)e};
+            if (!found || candidate < hit) {
+                hit = candidate;
+                found = true;
             }
-            float dist = distance(enemy.pos, proj.pos);
-            if (dist <= enemy.collider_rad + proj.collider_rad) {
-                KilledEnemyCount += 1;
-                enemy.life = false;
-                proj.life = false;
+        }
+    };
+
+    if (UseCollisionGrid){
+        // box around the whole swept segment
+        vec3 reach(proj.collider_rad[p] + max_enemy_rad);
+        vec3 lo = min(proj.prev_pos[p], proj.pos[p]) - reach;
+        vec3 hi = max(proj.prev_pos[p], proj.pos[p]) + reach;
+        enemyGrid.Query(lo, hi, test);
+    } else {
+        for (uint32_t e = 0; e < enemy.size(); ++e){
+            test(e);
+        }
+    }
+    return found;
+}
+
+// Projectiles are swept from prev_pos to pos, so a large step can't tunnel
+// through an enemy. Hits are resolved in time order: the earliest hit of
+// each projectile wins and every enemy dies only once. collisionHits is a
+// min-heap holding at most one pending hit per projectile; when the target
+// of a hit is already dead the projectile looks for its next one.
+// The first search runs on the job system, the resolution on this thread.
+void CheckCollision(){
+    float max_enemy_rad = 0.0f;
+    for (float rad : enemyContainer.collider_rad){
+        max_enemy_rad = max(max_enemy_rad, rad);
+    }
+    if (UseCollisionGrid){
+        enemyGrid.Build(enemyContainer.size(), 2.0f * max_enemy_rad,
+                        [](size_t i) { return enemyContainer.pos[i]; });
+    }
+
+    size_t n = projectileContainer.size();
+    projectileHit.resize(n);
+    projectileHasHit.resize(n);
+    jobs.ParallelFor(n, SimulationChunk, [max_enemy_rad](size_t begin, size_t end) {
+        for (size_t p = begin; p < end; ++p) {
+            projectileHasHit[p] = projectileContainer.life[p] && EarliestHit((int)p, max_enemy_rad, projectileHit[p]);
+        }
+    });
+
+    auto later = [](const CollisionHit& a, const CollisionHit& b) { return b < a; };
+    collisionHits.clear();
+    CollisionHit hit;
+    for (size_t p = 0; p < n; ++p){
+        if (projectileHasHit[p]){
+            collisionHits.push_back(projectileHit[p]);
+        }
+    }
+    std::make_heap(collisionHits.begin(), collisionHits.end(), later);
+
+    while (!collisionHits.empty()){
+        std::pop_heap(collisionHits.begin(), collisionHits.end(), later);
+        hit = collisionHits.back();
+        collisionHits.pop_back();
+
+        uint8_t& enemy_life = enemyContainer.life[hit.enemy];
+        if (enemy_life) {
+            KilledEnemyCount += 1;
+            enemy_life = false;
+            projectileContainer.life[hit.proj] = false;
+        } else if (EarliestHit(hit.proj, max_enemy_rad, hit)) {
+            collisionHits.push_back(hit);
+            std::push_heap(collisionHits.begin(), collisionHits.end(), later);
+        }
+    }
+}
+
+void DeleteDestroyedEnemies(){
+    const std::vector<uint8_t>& life = enemyContainer.life;
+    CompactStable(enemyContainer, [&life](size_t i) { return !life[i]; });
+}
+
+// Destroyed and too far projectiles are removed in the same pass.
+void DeleteDeadProjectiles(){
+    const ProjectileStore& proj = projectileContainer;
+    if (projectilesOnGPU) {
+        // out of range ones are freed by the GPU itself
+        for (size_t i = 0; i < proj.size(); ++i) {
+            if (!proj.life[i]) {
+                FeedbackEvent event = {FeedbackEvent::Kill, proj.handles.Handle(i).slot, vec3(0.0f), vec3(0.0f)};
+                feedbackEvents.push_back(event);
             }
         }
     }
+    CompactUnordered(projectileContainer, [&proj](size_t i) {
+        return !proj.life[i] || proj.out_of_range[i];
+    });
+}
+
+// Draw order of the enemies, far enemies first. It is kept between frames
+// as handles, so killed enemies drop out and new ones are appended, and
+// is re-sorted every frame on the view depth.
+std::vector<float> enemyDepth;
+std::vector<uint32_t> enemyDrawOrder;
+std::vector<EntityHandle> enemyDrawHandles;
+std::vector<uint8_t> enemyInDrawOrder;
+DepthSorter enemySorter;
+
+void SortEnemies(const glm::mat4& view){
+    size_t n = drawState.enemy_pos.size();
+    const vec3* pos = drawState.enemy_pos.data();
+
+    // distance in front of the camera, -z in view space
+    float zx = -view[0][2], zy = -view[1][2], zz = -view[2][2], zw = -view[3][2];
+    enemyDepth.resize(n);
+    float* depth = enemyDepth.data();
+    for (size_t i = 0; i < n; ++i) {
+        depth[i] = zx * pos[i].x + zy * pos[i].y + zz * pos[i].z + zw;
+    }
+
+    // last frame's order
+    enemyDrawOrder.clear();
+    enemyInDrawOrder.assign(n, 0);
+    for (EntityHandle handle : enemyDrawHandles) {
+        int i = drawState.EnemyIndex(handle);
+        if (i >= 0) {
+            enemyDrawOrder.push_back((uint32_t)i);
+            enemyInDrawOrder[i] = 1;
+        }
+    }
+    for (size_t i = 0; i < n; ++i) {
+        if (!enemyInDrawOrder[i]) {
+            enemyDrawOrder.push_back((uint32_t)i);
+        }
+    }
+
+    enemySorter.Sort(enemyDrawOrder, depth);
+
+    enemyDrawHandles.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        enemyDrawHandles[i] = drawState.enemy_handle[enemyDrawOrder[i]];
+    }
+}
+
+// Instances inside the view frustum this frame, indices into the stores.
+// Enemies keep the draw order.
+std::vector<uint32_t> enemyVisible;
+std::vector<uint32_t> projectileVisible;
+size_t enemyVisibleCount = 0;
+size_t projectileVisibleCount = 0;
+std::vector<size_t> cullChunkVisible;
+
+void CullInstances(const glm::mat4& MVP, float enemy_radius, float projectile_radius){
+    Frustum frustum = Frustum::FromMatrix(MVP);
+    enemyVisibleCount = ParallelCullSpheres(jobs, SimulationChunk, frustum, drawState.enemy_pos.data(), enemyDrawOrder.data(),
+                                            enemyDrawOrder.size(), enemy_radius, enemyVisible.data(), cullChunkVisible);
+    projectileVisibleCount = ParallelCullSpheres(jobs, SimulationChunk, frustum, drawState.projectile_pos.data(), nullptr,
+                                                 drawState.projectile_pos.size(), projectile_radius,
+                                                 projectileVisible.data(), cullChunkVisible);
+}
+
+// Levels of detail of the projectile mesh, the full mesh first. A visible
+// projectile whose projected radius is under ProjectileLodPixels[k] pixels
+// is drawn with level k + 1 or coarser.
+const int ProjectileLodCount = 4;
+const float ProjectileLodPixels[ProjectileLodCount - 1] = {64.0f, 32.0f, 16.0f};
+std::vector<MeshLod> projectileLods; // empty until the mesh is resident
+std::vector<uint8_t> projectileLod;  // level of projectileVisible[i]
+size_t projectileLodInstances[ProjectileLodCount];
+
+// pixels_per_unit is the projected size of one unit at distance one,
+// projection[1][1] * framebuffer height / 2.
+void SelectProjectileLods(const glm::mat4& view, float pixels_per_unit, float radius){
+    int coarsest = projectileLods.empty() ? 0 : (int)projectileLods.size() - 1;
+    float zx = -view[0][2], zy = -view[1][2], zz = -view[2][2], zw = -view[3][2];
+    jobs.ParallelFor(projectileVisibleCount, SimulationChunk, [=](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const vec3& p = drawState.projectile_pos[projectileVisible[i]];
+            float depth = zx * p.x + zy * p.y + zz * p.z + zw;
+            projectileLod[i] = (uint8_t)SelectLod(depth, radius, pixels_per_unit, ProjectileLodPixels, coarsest);
+        }
+    });
+    std::fill(projectileLodInstances, projectileLodInstances + ProjectileLodCount, 0);
+    for (size_t i = 0; i < projectileVisibleCount; ++i) {
+        projectileLodInstances[projectileLod[i]] += 1;
+    }
+}
+
+// Enemies come in waves of EnemyWaveSize every EnemyWaveInterval seconds,
+// as many as there is room for. Raise the wave size and MaxEnemies for
+// load tests.
+const size_t EnemyWaveSize = 1;
+const double EnemyWaveInterval = 3.0;
+WaveSpawner enemySpawner;
+
+// Placed in parallel, straight into the store.
+void SpawnEnemyWave(vec3 camera_pos){
+    size_t first_index = enemyContainer.size();
+    size_t count = enemyContainer.AddBatch(EnemyWaveSize);
+    uint64_t first_number = enemySpawner.Take(count);
+    vec3* pos = enemyContainer.pos.data() + first_index;
+    vec4* quaternion = enemyContainer.quaternion.data() + first_index;
+    jobs.ParallelFor(count, SimulationChunk, [=](size_t begin, size_t end) {
+        enemySpawner.Place(first_number, begin, end, camera_pos, pos, quaternion);
+    });
+}
+
+// Everything the simulation needs is reserved here, after this the frame
+// loop doesn't touch the heap.
+void InitEntityStorage(){
+    enemyContainer.Init(MaxEnemies);
+    projectileContainer.Init(MaxProjectiles);
+    enemyGrid.Reserve(MaxEnemies);
+    collisionHits.reserve(MaxProjectiles);
+    projectileHit.reserve(MaxProjectiles);
+    projectileHasHit.reserve(MaxProjectiles);
+    cullChunkVisible.reserve(jobs.max_chunks());
+    enemyDepth.reserve(MaxEnemies);
+    enemyDrawOrder.reserve(MaxEnemies);
+    enemyDrawHandles.reserve(MaxEnemies);
+    enemyInDrawOrder.reserve(MaxEnemies);
+    enemySorter.Reserve(MaxEnemies);
+    enemyVisible.resize(MaxEnemies);
+    projectileVisible.resize(MaxProjectiles);
+    projectileLod.resize(MaxProjectiles);
+#ifndef NDEBUG
+    feedbackReadback.reserve(MaxProjectiles);
+#endif
+}
+
+// The simulation runs on its own thread in fixed steps of SimulationStep
+// seconds, so its outcome doesn't depend on the frame rate. After every
+// batch of steps it publishes a snapshot, the render thread draws the
+// latest one, one step late: projectiles are interpolated between their
+// positions before and after the last step. The input goes the other way,
+// the camera of the last frame and the shots fired since.
+const double SimulationStep = 1.0 / 60.0;
+// steps per batch at most, after a longer stall the simulation falls behind
+const int MaxCatchUpSteps = 5;
+
+std::mutex simulationMutex;
+// guarded by simulationMutex
+SimulationSnapshot snapshots[2];
+int frontSnapshot = 0;
+vec3 inputCameraPosition(0.0f);
+std::vector<Shot> inputShots;
+std::vector<FeedbackEvent> publishedFeedbackEvents;
+// simulation thread only
+std::vector<Shot> stepShots;
+double enemySpawnTimer = 0.0;
+InputLogWriter inputRecording; // --record, the input of every step
+std::thread simulationThread;
+std::atomic<bool> simulationRunning(false);
+
+// Not profiled per step, a scope costs more than a step of a small scene;
+// the callers time whole batches of steps.
+void SimulationStepOnce(vec3 camera_pos){
+    inputRecording.Write(camera_pos, stepShots);
+    MoveProjectiles((float)SimulationStep, camera_pos);
+    if (projectilesOnGPU) {
+        FeedbackEvent event = {FeedbackEvent::Step, 0, camera_pos, vec3(0.0f)};
+        feedbackEvents.push_back(event);
+    }
+
+    // creating enemies
+    enemySpawnTimer -= SimulationStep;
+    if (enemySpawnTimer <= 0 && !enemyContainer.full()){
+        SpawnEnemyWave(camera_pos);
+        enemySpawnTimer = EnemyWaveInterval;
+    }
+
+    for (const Shot& shot : stepShots) {
+        EntityHandle projectile = projectileContainer.Add(shot.origin + shot.direction, shot.direction);
+        if (projectilesOnGPU && projectile.slot != UINT32_MAX) {
+            size_t i = projectileContainer.size() - 1;
+            FeedbackEvent event = {FeedbackEvent::Spawn, projectile.slot, projectileContainer.pos[i],
+                                   projectileContainer.direction[i] * projectileContainer.speed[i]};
+            feedbackEvents.push_back(event);
+        }
+    }
+    stepShots.clear();
+
+    CheckCollision();
+    DeleteDestroyedEnemies();
+    DeleteDeadProjectiles();
+}
+
+// Simulation thread: makes the state after tick the render thread's
+// snapshot, with the feedback events of the steps since the last one.
+void PublishSnapshot(uint64_t tick, double time){
+    snapshots[1 - frontSnapshot].Capture(tick, time);
+    {
+        std::lock_guard<std::mutex> lock(simulationMutex);
+        frontSnapshot = 1 - frontSnapshot;
+        publishedFeedbackEvents.insert(publishedFeedbackEvents.end(), feedbackEvents.begin(), feedbackEvents.end());
+    }
+    feedbackEvents.clear();
+}
+
+// Steps due at time now, counted from start. A batch is MaxCatchUpSteps
+// past tick at most, start moves up by the rest.
+uint64_t DueSteps(double now, double& start, uint64_t tick){
+    uint64_t due = (uint64_t)((now - start) / SimulationStep);
+    if (due > tick && due - tick > (uint64_t)MaxCatchUpSteps) {
+        start += (due - tick - MaxCatchUpSteps) * SimulationStep;
+        due = tick + MaxCatchUpSteps;
+    }
+    return due;
+}
+
+// Steps from tick up to due with the input submitted since the last
+// batch, then publishes the snapshot.
+void SimulateBatch(uint64_t& tick, uint64_t due, double start){
+    vec3 camera_pos;
+    {
+        std::lock_guard<std::mutex> lock(simulationMutex);
+        camera_pos = inputCameraPosition;
+        // the shots go into the first step of the batch
+        stepShots.swap(inputShots);
+    }
+    {
+        PROFILE_SCOPE("simulate");
+        while (tick < due) {
+            tick += 1;
+            SimulationStepOnce(camera_pos);
+        }
+    }
+
+    PublishSnapshot(tick, start + tick * SimulationStep);
 }
 
-template <typename T>
-void DeleteDestroyedObject(std::vector<T>& objects){
-    std::vector<int> deleted_ind;
-    for (int i = objects.size() - 1; i >= 0; --i) {
-        if (!objects[i].life) {
-            objects.erase(objects.begin() + i);
+void RunSimulation(){
+    double start = glfwGetTime();
+    uint64_t tick = 0;
+    PROFILE_THREAD("simulation");
+    while (simulationRunning.load(std::memory_order_acquire)) {
+        double now = glfwGetTime();
+        uint64_t due = DueSteps(now, start, tick);
+        if (due <= tick) {
+            std::this_thread::sleep_for(std::chrono::duration<double>(start + (tick + 1) * SimulationStep - now));
+            continue;
         }
+        SimulateBatch(tick, due, start);
+    }
+}
+
+// Render thread, before reading the snapshot.
+void SubmitInput(vec3 camera_pos, vec3 camera_direction, bool fire){
+    std::lock_guard<std::mutex> lock(simulationMutex);
+    inputCameraPosition = camera_pos;
+    if (fire && inputShots.size() < inputShots.capacity()) {
+        Shot shot = {camera_pos, normalize(camera_direction)};
+        inputShots.push_back(shot);
+    }
+}
+
+// Render thread: copies the latest snapshot into drawState for time now
+// and takes the feedback events published since the last call.
+void ReadSimulation(double now, std::vector<FeedbackEvent>& feedback_events){
+    std::lock_guard<std::mutex> lock(simulationMutex);
+    const SimulationSnapshot& snapshot = snapshots[frontSnapshot];
+    double alpha = (now - snapshot.time) / SimulationStep;
+    drawState.Copy(snapshot, (float)std::min(std::max(alpha, 0.0), 1.0));
+    feedback_events.clear();
+    feedback_events.swap(publishedFeedbackEvents);
+}
+
+void StartSimulation(){
+    for (SimulationSnapshot& snapshot : snapshots) {
+        snapshot.Reserve();
+    }
+    drawState.Reserve();
+    inputShots.reserve(MaxProjectiles);
+    stepShots.reserve(MaxProjectiles);
+    // a batch worth of events, more only if the render thread stalls
+    size_t batch_events = (size_t)MaxCatchUpSteps * (1 + 2 * MaxProjectiles);
+    feedbackEvents.reserve(batch_events);
+    publishedFeedbackEvents.reserve(batch_events);
+    simulationRunning = true;
+    simulationThread = std::thread(RunSimulation);
+}
+
+void StopSimulation(){
+    simulationRunning = false;
+    if (simulationThread.joinable()) {
+        simulationThread.join();
+    }
+    inputRecording.Close();
+}
+
+// Hash of the simulation state, the same after the same steps of the same
+// input log.
+uint64_t SimulationStateHash(){
+    uint64_t hash = HashBytes(&KilledEnemyCount, sizeof(KilledEnemyCount));
+    hash = HashBytes(enemyContainer.pos.data(), enemyContainer.size() * sizeof(vec3), hash);
+    hash = HashBytes(enemyContainer.quaternion.data(), enemyContainer.size() * sizeof(vec4), hash);
+    hash = HashBytes(projectileContainer.pos.data(), projectileContainer.size() * sizeof(vec3), hash);
+    hash = HashBytes(projectileContainer.direction.data(), projectileContainer.size() * sizeof(vec3), hash);
+    return hash;
+}
+
+// Vertex formats of the cooked meshes
+struct EnemyVertex {
+    vec3 position; // location 0
+    vec3 color;    // location 3
+};
+
+struct ProjectileVertex {
+    vec3 position; // location 0
+    vec2 uv;       // location 2
+
+    // identifies the format in the mesh cache, change it with the struct
+    static const char* const Layout;
+};
+
+const char* const ProjectileVertex::Layout = "position:vec3 uv:vec2";
+
+// Radius of the bounding sphere around the mesh origin, the instance
+// position.
+template <typename Vertex>
+float BoundingRadius(const IndexedMesh<Vertex>& mesh){
+    float radius2 = 0.0f;
+    for (const Vertex& vertex : mesh.vertices) {
+        radius2 = std::max(radius2, dot(vertex.position, vertex.position));
+    }
+    return sqrt(radius2);
+}
+
+template <typename Vertex>
+void PrintMeshReport(const char* name, size_t unindexed_vertices, const IndexedMesh<Vertex>& mesh){
+    // the unindexed draw of the source triangles, every corner its own vertex
+    std::vector<uint32_t> source_indices(unindexed_vertices);
+    for (size_t i = 0; i < unindexed_vertices; ++i) {
+        source_indices[i] = (uint32_t)i;
     }
+    printf("%s: %zu vertices, ACMR %.2f unindexed -> %zu vertices, %zu indices, ACMR %.2f\n",
+           name, unindexed_vertices, ComputeACMR(source_indices), mesh.vertices.size(), mesh.indices.size(),
+           ComputeACMR(mesh.indices));
 }
 
-void DeleteFarProjectiles(){
-    for (int i = (int)projectileContainer.size() - 1; i >= 0; --i) {
-        vec3 cam_pos = getCameraPosition();
-        float dist = distance(projectileContainer[i].pos, cam_pos);
-        if (dist >= 35) {
-            projectileContainer.erase(projectileContainer.begin() + i);
+// Runs on the asset loader thread. The mesh comes from the binary cache of
+// the cooked mesh when it is up to date, the .obj is parsed and cooked
+// only otherwise. False if the .obj can't be read, nothing is cached then.
+bool LoadProjectileMesh(const char* path, IndexedMesh<ProjectileVertex>& mesh){
+    double load_start = glfwGetTime();
+    MeshSource source;
+    size_t source_vertices = 0;
+    if (StatMeshSource(path, source) && LoadMeshCache(path, ProjectileVertex::Layout, source, mesh, source_vertices)) {
+        printf("%s: loaded from mesh cache in %.1f ms\n", path, (glfwGetTime() - load_start) * 1000.0);
+    } else {
+        // Read our .obj file
+        std::vector<vec3> vertices_proj;
+        std::vector<vec2> uvs_proj;
+        std::vector<vec3> normals_proj; // Won't be used at the moment.
+        if (!LoadOBJParallel(jobs, path, vertices_proj, uvs_proj, normals_proj) || vertices_proj.empty()) {
+            fprintf(stderr, "%s: no mesh, projectiles aren't drawn\n", path);
+            return false;
         }
+
+        std::vector<ProjectileVertex> triangles(vertices_proj.size());
+        for (size_t i = 0; i < triangles.size(); ++i) {
+            triangles[i].position = vertices_proj[i];
+            triangles[i].uv = uvs_proj[i];
+        }
+        mesh = CookMesh(triangles);
+        source_vertices = triangles.size();
+        SaveMeshCache(path, ProjectileVertex::Layout, source, mesh, source_vertices);
+        printf("%s: parsed and cooked in %.1f ms\n", path, (glfwGetTime() - load_start) * 1000.0);
+    }
+    PrintMeshReport(path, source_vertices, mesh);
+    return true;
+}
+
+// Stands in for textures that are still loading.
+GLuint CreatePlaceholderTexture(){
+    const uint8_t white[4] = {255, 255, 255, 255};
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, white);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    return texture;
+}
+
+// Startup instrumentation
+std::chrono::steady_clock::time_point startupTime;
+
+double MillisecondsSince(std::chrono::steady_clock::time_point start){
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Time per frame the asset uploads may take, in seconds.
+const double AssetUploadBudget = 0.002;
+
+// Mip levels uploaded per frame and texture memory, in bytes.
+const size_t TextureUploadBudget = 256 * 1024;
+const size_t TextureMemoryBudget = 64 * 1024 * 1024;
+
+// Interleaved per-instance record of the enemy draw
+struct EnemyInstance {
+    vec4 quaternion; // location 1
+    vec3 position;   // location 2
+};
+
+// Pipeline state of one draw: the program with its MVP uniform and vertex
+// array objects configured once at startup. Instanced draws source their
+// instance attributes from instanceStream, which sits at a different offset
+// in every region, so there is one VAO per region.
+struct Drawable {
+    GLuint program;
+    GLuint mvp_location;
+    GLuint vao[StreamBuffer::Regions];
+    int vao_count;
+
+    // one VAO per source of the instance data, a region by default
+    Drawable(GLuint program_id, GLuint mvp, int vaos = StreamBuffer::Regions)
+        : program(program_id), mvp_location(mvp), vao_count(vaos) {
+        glGenVertexArrays(vao_count, vao);
+    }
+
+    void Bind(int index, const mat4& MVP) const {
+        glUseProgram(program);
+        glUniformMatrix4fv(mvp_location, 1, GL_FALSE, &MVP[0][0]);
+        glBindVertexArray(vao[index]);
+    }
+
+    void Destroy(){
+        glDeleteVertexArrays(vao_count, vao);
+    }
+};
+
+// --replay: runs the steps of an input log as fast as they go, without a
+// window or GL context. Prints the state hash every hash_every steps and
+// the step rate at the end.
+// With render_fps above 0 a snapshot is published after every step and a
+// stand-in for the render thread reads, sorts and culls the latest one
+// render_fps times a second, sharing the job system with the replay. The
+// outcome must not change with it: the simulation doesn't depend on how
+// often or when it is drawn.
+// With live_input the input goes the player's way instead, see
+// ReplayLiveInput.
+const int ReplayBatchSteps = 60;
+
+void RunReplayRenderer(double render_fps, const std::atomic<bool>& replaying, unsigned long& frames){
+    std::vector<FeedbackEvent> feedback_events;
+    glm::mat4 view = glm::lookAt(vec3(0.0f, 0.0f, 40.0f), vec3(0.0f), vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 4.0f / 3.0f, 0.1f, 100.0f);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::chrono::duration<double> frame_time(1.0 / render_fps);
+    while (replaying.load(std::memory_order_acquire)) {
+        ReadSimulation(MillisecondsSince(start) * 0.001, feedback_events);
+        SortEnemies(view);
+        CullInstances(projection * view, 1.0f, 1.0f);
+        frames += 1;
+        std::this_thread::sleep_for(frame_time);
     }
 }
 
-void SortEnemies(){
-    std::sort(enemyContainer.begin(), enemyContainer.end());
+// --live-input: the log's input is handed to SubmitInput by a render loop
+// at render_fps, as the clicks and the camera of each frame, and the
+// simulation takes it in batches as RunSimulation does, on a clock that
+// moves one frame per loop instead of glfwGetTime. A frame of several
+// steps puts all its shots into the first step of the batch and steers
+// the batch with its last camera, and under 12 fps the simulation falls
+// behind: the outcome is the frame rate's own. With --record the input
+// the steps got is written, a replay of it must end in the same state.
+// No hashes are printed on the way. Returns the steps run.
+uint64_t ReplayLiveInput(InputLogReader& log, double render_fps){
+    inputShots.reserve(MaxProjectiles);
+    stepShots.reserve(MaxProjectiles);
+    std::vector<Shot> record_shots;
+    vec3 camera_pos;
+    double start = 0.0;
+    uint64_t tick = 0;
+    uint64_t submitted = 0; // log records handed over so far
+    bool more = true;
+    for (uint64_t frame = 1; more; ++frame) {
+        double now = frame / render_fps;
+        while (submitted < (uint64_t)(now / SimulationStep) && (more = log.Next(camera_pos, record_shots))) {
+            submitted += 1;
+            for (const Shot& shot : record_shots) {
+                SubmitInput(shot.origin, shot.direction, true);
+            }
+            SubmitInput(camera_pos, vec3(0.0f, 0.0f, -1.0f), false);
+        }
+        uint64_t due = DueSteps(now, start, tick);
+        // the session ends with the log, not a step past it
+        if (more && due > tick) {
+            SimulateBatch(tick, due, start);
+        }
+    }
+    return tick;
 }
 
-void CreateEnemy(){
-    float w = rand() % 360;
-    float x_q = rand() % 21 - 10;
-    float y_q = rand() % 21 - 10;
-    float z_q = rand() % 21 - 10;
+int ReplayInputLog(const char* path, unsigned long hash_every, double render_fps, bool live_input,
+                   const char* record_path){
+    InputLogReader log;
+    if (!log.Open(path)) {
+        return -1;
+    }
+    if (log.step() != (float)SimulationStep) {
+        fprintf(stderr, "%s: recorded with %g s steps, the simulation steps %g s\n", path, log.step(), SimulationStep);
+        return -1;
+    }
+    enemySpawner.Seed(log.seed());
+    jobs.Start();
+    InitEntityStorage();
+    const char* kernel_name;
+    moveProjectilesKernel = SelectProjectileKernel(&kernel_name);
+    printf("replaying %s: seed %u, %s kernel, %d threads\n", path, log.seed(), kernel_name, jobs.thread_count());
+    PROFILE_THREAD("simulation");
+
+    if (live_input && render_fps <= 0.0) {
+        fprintf(stderr, "--live-input needs a --render-fps above 0\n");
+        return -1;
+    }
+    if (record_path != nullptr && inputRecording.Open(record_path, log.seed(), (float)SimulationStep)) {
+        printf("recording input to %s\n", record_path);
+    }
 
-    float x_p = rand() % 21 - 10;
-    float y_p = rand() % 21 - 10;
-    float z_p = rand() % 21 - 10;
-    float rad = rand() % 20 + 12;
+    std::atomic<bool> replaying(true);
+    unsigned long render_frames = 0;
+    std::thread renderer;
+    if (render_fps > 0.0) {
+        for (SimulationSnapshot& snapshot : snapshots) {
+            snapshot.Reserve();
+        }
+        drawState.Reserve();
+    }
+    if (render_fps > 0.0 && !live_input) {
+        renderer = std::thread(RunReplayRenderer, render_fps, std::cref(replaying), std::ref(render_frames));
+    }
 
-    vec3 pos(x_p, y_p, z_p);
-    pos += getCameraPosition();
-    vec3 rot_axis(x_q, y_q, z_q);
-    pos = normalize(pos) * rad;
-    enemyContainer.emplace_back(Enemy(pos, normalize(rot_axis), w));
+    vec3 camera_pos;
+    unsigned long long steps = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    if (live_input) {
+        steps = ReplayLiveInput(log, render_fps);
+        printf("live input at %g fps\n", render_fps);
+    }
+    bool more = !live_input;
+    while (more) {
+        // a scope per simulated second
+        PROFILE_SCOPE("simulate");
+        for (int i = 0; i < ReplayBatchSteps && (more = log.Next(camera_pos, stepShots)); ++i) {
+            SimulationStepOnce(camera_pos);
+            steps += 1;
+            if (render_fps > 0.0) {
+                PublishSnapshot(steps, steps * SimulationStep);
+            }
+            if (hash_every != 0 && steps % hash_every == 0) {
+                printf("step %llu: state %016llx\n", steps, (unsigned long long)SimulationStateHash());
+            }
+        }
+    }
+    double elapsed = MillisecondsSince(start);
+    replaying = false;
+    if (renderer.joinable()) {
+        renderer.join();
+        printf("%lu frames drawn at %g fps\n", render_frames, render_fps);
+    }
+    printf("%llu steps in %.1f ms, %.0f steps/s\n", steps, elapsed, steps / std::max(elapsed * 0.001, 1e-9));
+    // the outcome on a line of its own, tests/check_replay.sh compares it
+    printf("%d enemies killed, state %016llx\n", KilledEnemyCount, (unsigned long long)SimulationStateHash());
+    inputRecording.Close();
+#ifdef ENABLE_PROFILER
+    GetProfiler().Summarize();
+    GetProfiler().PrintSummary();
+#endif
+    jobs.Stop();
+    return 0;
 }
 
-int main( void )
+int main( int argc, char* argv[] )
 {
+    startupTime = std::chrono::steady_clock::now();
+
+    const char* record_path = nullptr;
+    const char* replay_path = nullptr;
+    unsigned long hash_every = 600;
+    double render_fps = 0.0;
+    bool live_input = false;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            record_path = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replay_path = argv[++i];
+        } else if (strcmp(argv[i], "--hash-every") == 0 && i + 1 < argc) {
+            hash_every = strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--render-fps") == 0 && i + 1 < argc) {
+            render_fps = strtod(argv[++i], nullptr);
+        } else if (strcmp(argv[i], "--live-input") == 0) {
+            live_input = true;
+        } else {
+            fprintf(stderr, "usage: %s [--record <input log>] [--replay <input log> [--hash-every <steps>] [--render-fps <fps> [--live-input]]]\n", argv[0]);
+            return -1;
+        }
+    }
+    if (replay_path != nullptr) {
+        return ReplayInputLog(replay_path, hash_every, render_fps, live_input, record_path);
+    }
+
 	// Initialise GLFW
 	if( !glfwInit() )
 	{
@@ -152,6 +1194,9 @@ int main( void )
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE); // To make MacOS happy; should not be needed
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE); //We don't want the old OpenGL 
+#ifndef NDEBUG
+	glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GL_TRUE);
+#endif
 
 	// Open a window and create its OpenGL context
 	window = glfwCreateWindow( 1024, 768, "Homework 2 - Shooter", nullptr, nullptr);
@@ -175,6 +1220,17 @@ int main( void )
 	// Ensure we can capture the escape key being pressed below
 	glfwSetInputMode(window, GLFW_STICKY_KEYS, GL_TRUE);
 
+#ifdef COUNT_GL_CALLS
+    WrapGLFunctions();
+#endif
+
+#ifndef NDEBUG
+    // report invalid uploads and draws as they happen
+    if (GLEW_KHR_debug) {
+        EnableGLDebugOutput();
+    }
+#endif
+
     glfwPollEvents();
 	// Dark blue background
 	glClearColor(0.0f, 0.0f, 0.4f, 0.0f);
@@ -186,13 +1242,72 @@ int main( void )
     // Accept fragment if it closer to the camera than the former one
     glDepthFunc(GL_LESS);
 
-	GLuint VertexArrayID;
-	glGenVertexArrays(1, &VertexArrayID);
-	glBindVertexArray(VertexArrayID);
+    // The projectile mesh and texture are read on the loader thread while
+    // the shaders compile, and uploaded from the frame loop once decoded.
+    // The buffers exist from the start so the VAOs can be built now, the
+    // projectiles aren't drawn until their mesh is resident and use a
+    // white texture until theirs is.
+    GLuint projectile_vertex_buffer;
+    glGenBuffers(1, &projectile_vertex_buffer);
+    GLuint projectile_index_buffer;
+    glGenBuffers(1, &projectile_index_buffer);
+    float projectile_radius = 0.0f;
+    GLuint placeholder_texture = CreatePlaceholderTexture();
+    int projectileTexture = -1; // in textureStreamer
+
+    // before the asset loader, which parses on the job threads too
+    jobs.Start();
+    printf("job system: %d threads\n", jobs.thread_count());
+    AssetLoader assetLoader;
+    assetLoader.Start();
+    TextureStreamer textureStreamer;
+    textureStreamer.Init(TextureUploadBudget, TextureMemoryBudget);
+
+    // all levels of detail in one vertex and one index buffer
+    std::shared_ptr<IndexedMesh<ProjectileVertex> > projectile_mesh = std::make_shared<IndexedMesh<ProjectileVertex> >();
+    std::shared_ptr<std::vector<MeshLod> > projectile_lods = std::make_shared<std::vector<MeshLod> >();
+    assetLoader.Load("sphera_v04.obj",
+        [projectile_mesh, projectile_lods]() {
+            IndexedMesh<ProjectileVertex> mesh;
+            if (!LoadProjectileMesh("sphera_v04.obj", mesh)) {
+                return;
+            }
+            BuildMeshLods(mesh, ProjectileLodCount, *projectile_mesh, *projectile_lods);
+            printf("sphera_v04.obj: %zu levels of detail, triangles", projectile_lods->size());
+            for (const MeshLod& lod : *projectile_lods) {
+                printf(" %u", lod.index_count / 3);
+            }
+            printf("\n");
+        },
+        [projectile_mesh, projectile_lods, projectile_vertex_buffer, projectile_index_buffer, &projectile_radius]() {
+            glBindBuffer(GL_ARRAY_BUFFER, projectile_vertex_buffer);
+            glBufferData(GL_ARRAY_BUFFER, projectile_mesh->vertices.size() * sizeof(ProjectileVertex), projectile_mesh->vertices.data(), GL_STATIC_DRAW);
+            glBindBuffer(GL_ARRAY_BUFFER, projectile_index_buffer);
+            glBufferData(GL_ARRAY_BUFFER, projectile_mesh->indices.size() * sizeof(uint32_t), projectile_mesh->indices.data(), GL_STATIC_DRAW);
+            projectileLods.swap(*projectile_lods);
+            // Projectile.vertexshader draws the mesh at twice its size
+            projectile_radius = 2.0f * BoundingRadius(*projectile_mesh);
+            *projectile_mesh = IndexedMesh<ProjectileVertex>();
+        });
+
+    std::shared_ptr<DDSImage> projectile_image = std::make_shared<DDSImage>();
+    assetLoader.Load("uvmap.dds",
+        [projectile_image]() {
+            ReadDDS("uvmap.dds", *projectile_image);
+        },
+        [projectile_image, &textureStreamer, &projectileTexture]() {
+            projectileTexture = textureStreamer.Add(*projectile_image);
+        });
 
 	// Create and compile our GLSL program from the shaders
-    GLuint programID1 = LoadShaders( "Enemy.vertexshader", "Enemy.fragmentshader" );
-    GLuint programID2 = LoadShaders( "Projectile.vertexshader", "Projectile.fragmentshader" );
+    const ShaderProgramFiles program_files[2] = {
+        {"Enemy.vertexshader", "Enemy.fragmentshader"},
+        {"Projectile.vertexshader", "Projectile.fragmentshader"},
+    };
+    GLuint programIDs[2];
+    LoadShaderPrograms(program_files, 2, programIDs);
+    GLuint programID1 = programIDs[0];
+    GLuint programID2 = programIDs[1];
 
 	// Get a handle for our "MVP" uniform
 	GLuint MatrixID1 = glGetUniformLocation(programID1, "MVP");
@@ -200,18 +1315,6 @@ int main( void )
 
     GLuint TextureID  = glGetUniformLocation(programID2, "ProjectileTexture");
 
-    GLuint Texture = loadDDS("uvmap.dds");
-
-
-    // Read our .obj file
-    std::vector<vec3> vertices_proj;
-    std::vector<vec2> uvs_proj;
-    std::vector<vec3> normals_proj; // Won't be used at the moment.
-    bool res1 = loadOBJ("sphera_v04.obj", vertices_proj, uvs_proj, normals_proj);
-
-    static std::vector<vec3> g_enemy_position_data(MaxEnemies);
-    static std::vector<vec4> g_enemy_quat_data(MaxEnemies);
-    static std::vector<vec3> g_projectile_position_data(MaxProjectiles);
 
     static const GLfloat g_vertex_buffer_data[] = {
             0.0f, 1.0f, 0.0f,
@@ -282,268 +1385,435 @@ int main( void )
             0.05f, 0.1f, 0.6f
     };
 
-    // points of the enemy
+    // Both meshes are welded into indexed meshes and reordered for the
+    // vertex cache
+    std::vector<EnemyVertex> enemy_triangles(8 * 3);
+    for (size_t i = 0; i < enemy_triangles.size(); ++i) {
+        enemy_triangles[i].position = vec3(g_vertex_buffer_data[i * 3], g_vertex_buffer_data[i * 3 + 1], g_vertex_buffer_data[i * 3 + 2]);
+        enemy_triangles[i].color = vec3(g_color_buffer_data[i * 3], g_color_buffer_data[i * 3 + 1], g_color_buffer_data[i * 3 + 2]);
+    }
+    IndexedMesh<EnemyVertex> enemyMesh = CookMesh(enemy_triangles);
+    PrintMeshReport("enemy", enemy_triangles.size(), enemyMesh);
+    float enemy_radius = BoundingRadius(enemyMesh);
+
+
+    // points and colors of the enemy
 	GLuint enemy_vertex_buffer;
 	glGenBuffers(1, &enemy_vertex_buffer);
 	glBindBuffer(GL_ARRAY_BUFFER, enemy_vertex_buffer);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(g_vertex_buffer_data), g_vertex_buffer_data, GL_STATIC_DRAW);
-
-    // positions of the enemy
-    GLuint enemy_position_buffer;
-    glGenBuffers(1, &enemy_position_buffer);
-    glBindBuffer(GL_ARRAY_BUFFER, enemy_position_buffer);
-    glBufferData(GL_ARRAY_BUFFER, MaxEnemies * sizeof(vec3), nullptr, GL_STREAM_DRAW);
-
-    // quaternion of the enemy
-    GLuint enemy_rotation_axis_buffer;
-    glGenBuffers(1, &enemy_rotation_axis_buffer);
-    glBindBuffer(GL_ARRAY_BUFFER, enemy_rotation_axis_buffer);
-    glBufferData(GL_ARRAY_BUFFER, MaxEnemies * sizeof(vec4), nullptr, GL_STREAM_DRAW);
-
-    // color of the enemy
-    GLuint enemy_color_buffer;
-    glGenBuffers(1, &enemy_color_buffer);
-    glBindBuffer(GL_ARRAY_BUFFER, enemy_color_buffer);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(g_color_buffer_data), g_color_buffer_data, GL_STREAM_DRAW);
-
-    // points of the projectile
-    GLuint projectile_vertex_buffer;
-    glGenBuffers(1, &projectile_vertex_buffer);
-    glBindBuffer(GL_ARRAY_BUFFER, projectile_vertex_buffer);
-    glBufferData(GL_ARRAY_BUFFER, vertices_proj.size() * sizeof(vec3), &vertices_proj[0], GL_STREAM_DRAW);
-
-    // positions of the projectile
-    GLuint projectile_position_buffer;
-    glGenBuffers(1, &projectile_position_buffer);
-    glBindBuffer(GL_ARRAY_BUFFER, projectile_position_buffer);
-    glBufferData(GL_ARRAY_BUFFER, MaxProjectiles * sizeof(vec3), nullptr, GL_STREAM_DRAW);
-
-    // uvs of the projectile
-    GLuint projectile_uvbuffer;
-    glGenBuffers(1, &projectile_uvbuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, projectile_uvbuffer);
-    glBufferData(GL_ARRAY_BUFFER, uvs_proj.size() * sizeof(vec2), &uvs_proj[0], GL_STATIC_DRAW);
-
-    double last_time = glfwGetTime();
-    double create_time = 0.0f;
-    bool mouse_left_pressed = false;
-    bool mouse_left_released = true;
-    srand(time(0));
-	do{
-        //  MVP-        
-        computeMatricesFromInputs();
-        glm::mat4 ProjectionMatrix = getProjectionMatrix();
-        glm::mat4 ViewMatrix = getViewMatrix();
-        glm::mat4 ModelMatrix = glm::mat4(1.0);
-        glm::mat4 MVP = ProjectionMatrix * ViewMatrix * ModelMatrix;
-
-        double current_time = glfwGetTime();
-        double delta = current_time - last_time;
-        last_time = current_time;
-
-        MoveProjectiles(float(delta));
-        // creating enemies
-        create_time -= delta;
-        if (create_time <= 0 && enemyContainer.size() < MaxEnemies){
-            CreateEnemy();
-            create_time = 3.0f;
-            SortEnemies();
-        }
-
-        //   
-        if (mouse_left_released && glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS && projectileContainer.size() < MaxProjectiles) {
-            mouse_left_pressed = true;
-            mouse_left_released = false;
-        }
-
-        if (mouse_left_pressed && glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_RELEASE) {
-            mouse_left_pressed = false;
-            mouse_left_released = true;
-            std::cout << "create projectile\n";
-            vec3 camera_pos = getCameraPosition();
-            vec3 camera_direction = getCameraDirection();
-            projectileContainer.emplace_back(Projectile(camera_pos + normalize(camera_direction), normalize(camera_direction)));
-        }
-
-
-        for (int i = 0; i < enemyContainer.size(); ++i){
-            Enemy& enemy = enemyContainer[i];
-            g_enemy_position_data[i] = enemy.pos;
-            g_enemy_quat_data[i] = enemy.quaternion;
-        }
-
-        for (int i = 0; i < projectileContainer.size(); ++i){
-            Projectile& proj = projectileContainer[i];
-            g_projectile_position_data[i] = proj.pos;
-        }
+	glBufferData(GL_ARRAY_BUFFER, enemyMesh.vertices.size() * sizeof(EnemyVertex), enemyMesh.vertices.data(), GL_STATIC_DRAW);
 
-        glBindBuffer(GL_ARRAY_BUFFER, enemy_position_buffer);
-        glBufferData(GL_ARRAY_BUFFER, MaxEnemies * sizeof(vec3), nullptr, GL_STREAM_DRAW);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, enemyContainer.size() * sizeof(vec3), &g_enemy_position_data[0]);
+    GLuint enemy_index_buffer;
+    glGenBuffers(1, &enemy_index_buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, enemy_index_buffer);
+    glBufferData(GL_ARRAY_BUFFER, enemyMesh.indices.size() * sizeof(uint32_t), enemyMesh.indices.data(), GL_STATIC_DRAW);
 
-        glBindBuffer(GL_ARRAY_BUFFER, enemy_rotation_axis_buffer);
-        glBufferData(GL_ARRAY_BUFFER, MaxEnemies * sizeof(quat), nullptr, GL_STREAM_DRAW);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, enemyContainer.size() * sizeof(vec4) * 4, &g_enemy_quat_data[0]);
+    // per-frame instance data
+    StreamBuffer instanceStream;
 
-        glBindBuffer(GL_ARRAY_BUFFER, projectile_position_buffer);
-        glBufferData(GL_ARRAY_BUFFER, MaxProjectiles * sizeof(vec3), nullptr, GL_STREAM_DRAW);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, projectileContainer.size() * sizeof(vec3), &g_projectile_position_data[0]);
+    InstanceUpload<EnemyInstance> enemyInstances;
+    enemyInstances.Init("enemy instances", MaxEnemies, instanceStream);
+    enemyInstances.AddAttribute<vec4>(1, offsetof(EnemyInstance, quaternion));
+    enemyInstances.AddAttribute<vec3>(2, offsetof(EnemyInstance, position));
 
+    // one slot per level of detail, each one is a separate draw
+    static const char* const projectile_upload_names[ProjectileLodCount] = {
+        "projectile lod 0 instances", "projectile lod 1 instances", "projectile lod 2 instances", "projectile lod 3 instances"
+    };
+    InstanceUpload<vec3> projectileInstances[ProjectileLodCount];
+    for (int lod = 0; lod < ProjectileLodCount; ++lod) {
+        projectileInstances[lod].Init(projectile_upload_names[lod], MaxProjectiles, instanceStream);
+        projectileInstances[lod].AddAttribute<vec3>(1, 0);
+    }
 
-		// Clear the screen
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    instanceStream.Init();
 
-		// Enemies
-		glUseProgram(programID1);
+    projectilesOnGPU = SimulateProjectilesOnGPU && projectileFeedback.Init(MaxProjectiles);
 
-		// Send our transformation to the currently bound shader, 
-		// in the "MVP" uniform
-		glUniformMatrix4fv(MatrixID1, 1, GL_FALSE, &MVP[0][0]);
+    // Vertex state of all draws is built once here. Projectiles simulated
+    // on the GPU are all drawn at full detail, from the feedback buffers.
+    Drawable enemyDraw(programID1, MatrixID1);
+    std::vector<Drawable> projectileDraws;
+    for (int lod = 0; lod < (projectilesOnGPU ? 1 : ProjectileLodCount); ++lod) {
+        projectileDraws.push_back(Drawable(programID2, MatrixID2, projectilesOnGPU ? 2 : StreamBuffer::Regions));
+    }
+    for (int region = 0; region < StreamBuffer::Regions; ++region) {
+        glBindVertexArray(enemyDraw.vao[region]);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, enemy_index_buffer);
 
-        // 1 attribute buffer : enemy_vertex_buffer
-        glEnableVertexAttribArray(0);
+        // 1, 4 attribute buffers : positions and colors in enemy_vertex_buffer
         glBindBuffer(GL_ARRAY_BUFFER, enemy_vertex_buffer);
+        glEnableVertexAttribArray(0);
         glVertexAttribPointer(
                 0,                  // attribute
                 3,                  // size
                 GL_FLOAT,           // type
                 GL_FALSE,           // normalized?
-                0,                  // stride
-                (void*)0            // array buffer offset
-        );
-
-        // 2 attribute buffer : enemy_rotation_axis_buffer
-        glEnableVertexAttribArray(1);
-        glBindBuffer(GL_ARRAY_BUFFER, enemy_rotation_axis_buffer);
-        glVertexAttribPointer(
-                1,                  // attribute
-                4,                  // size
-                GL_FLOAT,           // type
-                GL_FALSE,           // normalized?
-                0,                  // stride
-                (void*)0            // array buffer offset
-        );
-
-        // 3 attribute buffer : enemy_position_buffer
-        glEnableVertexAttribArray(2);
-        glBindBuffer(GL_ARRAY_BUFFER, enemy_position_buffer);
-        glVertexAttribPointer(
-                2,                  // attribute
-                3,                  // size
-                GL_FLOAT,           // type
-                GL_FALSE,           // normalized?
-                0,                  // stride
-                (void*)0            // array buffer offset
+                sizeof(EnemyVertex), // stride
+                (void*)offsetof(EnemyVertex, position) // array buffer offset
         );
-
-        // 4 attribute buffer : enemy_color_buffer
         glEnableVertexAttribArray(3);
-        glBindBuffer(GL_ARRAY_BUFFER, enemy_color_buffer);
         glVertexAttribPointer(
                 3,                  // attribute
                 3,                  // size
                 GL_FLOAT,           // type
                 GL_FALSE,           // normalized?
-                0,                  // stride
-                (void*)0            // array buffer offset
+                sizeof(EnemyVertex), // stride
+                (void*)offsetof(EnemyVertex, color) // array buffer offset
         );
 
-        glVertexAttribDivisor(0, 0);
-        glVertexAttribDivisor(1, 1);
-        glVertexAttribDivisor(2, 1);
-        glVertexAttribDivisor(3, 0);
+        // 2, 3 attribute buffers : quaternions and positions in instanceStream
+        glBindBuffer(GL_ARRAY_BUFFER, instanceStream.buffer());
+        enemyInstances.SetPointers(instanceStream, region);
+    }
+    for (size_t lod = 0; lod < projectileDraws.size(); ++lod) {
+        for (int i = 0; i < projectileDraws[lod].vao_count; ++i) {
+            glBindVertexArray(projectileDraws[lod].vao[i]);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, projectile_index_buffer);
+
+            // 1, 3 attribute buffers : positions and uvs in projectile_vertex_buffer
+            glBindBuffer(GL_ARRAY_BUFFER, projectile_vertex_buffer);
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(
+                    0,                  // attribute
+                    3,                  // size
+                    GL_FLOAT,           // type
+                    GL_FALSE,           // normalized?
+                    sizeof(ProjectileVertex), // stride
+                    (void*)offsetof(ProjectileVertex, position) // array buffer offset
+            );
+            glEnableVertexAttribArray(2);
+            glVertexAttribPointer(
+                    2,                  // attribute
+                    2,                  // size
+                    GL_FLOAT,           // type
+                    GL_FALSE,           // normalized?
+                    sizeof(ProjectileVertex), // stride
+                    (void*)offsetof(ProjectileVertex, uv) // array buffer offset
+            );
+
+            if (projectilesOnGPU) {
+                // 2 attribute buffer : projectile records in feedback buffer i
+                glBindBuffer(GL_ARRAY_BUFFER, projectileFeedback.buffer(i));
+                glEnableVertexAttribArray(1);
+                glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(ProjectileFeedback::Record),
+                                      (void*)offsetof(ProjectileFeedback::Record, position));
+                glVertexAttribDivisor(1, 1);
+            } else {
+                // 2 attribute buffer : projectile positions of the level in region i of instanceStream
+                glBindBuffer(GL_ARRAY_BUFFER, instanceStream.buffer());
+                projectileInstances[lod].SetPointers(instanceStream, i);
+            }
+        }
+    }
+    glBindVertexArray(0);
+
+    // Set our "ProjectileTexture" sampler to use Texture Unit 0
+    glUseProgram(programID2);
+    glUniform1i(TextureID, 0);
+
+#if defined(COUNT_GL_CALLS) || !defined(NDEBUG) || defined(ENABLE_PROFILER) || defined(REPORT_CULLING)
+    double loop_start_time = glfwGetTime();
+#endif
+#ifdef COUNT_GL_CALLS
+    double gl_call_report_time = loop_start_time;
+    unsigned long gl_call_frames = 0;
+    GLCallCount() = 0;
+#endif
+#ifndef NDEBUG
+    double feedback_check_time = loop_start_time;
+#endif
+#ifdef ENABLE_PROFILER
+    double profile_report_time = loop_start_time;
+    PROFILE_THREAD("render");
+    GetGpuProfiler().Init();
+#endif
+#ifdef REPORT_CULLING
+    double cull_report_time = loop_start_time;
+    unsigned long cull_frames = 0;
+    size_t enemies_visible = 0, enemies_total = 0;
+    size_t projectiles_visible = 0, projectiles_total = 0;
+    size_t projectile_triangles = 0, projectile_triangles_full = 0;
+#endif
+    std::vector<FeedbackEvent> frame_feedback_events;
+    frame_feedback_events.reserve((size_t)MaxCatchUpSteps * (1 + 2 * MaxProjectiles));
+    bool mouse_left_pressed = false;
+    bool mouse_left_released = true;
+    uint32_t seed = (uint32_t)time(0);
+    enemySpawner.Seed(seed);
+    // from here on the frame loop logs through the logger thread
+    GetAsyncLogger().Start();
+    InitEntityStorage();
+    const char* kernel_name;
+    moveProjectilesKernel = SelectProjectileKernel(&kernel_name);
+    printf("projectile kernel: %s\n", kernel_name);
+    if (record_path != nullptr && inputRecording.Open(record_path, seed, (float)SimulationStep)) {
+        printf("recording input to %s\n", record_path);
+    }
+    StartSimulation();
+#ifdef TRACK_HEAP_ALLOCATIONS
+    // the first frames still warm up the driver
+    const int AllocationWarmupFrames = 10;
+    int frame_index = 0;
+#endif
+    bool first_frame = true;
+    bool assets_resident = false;
+	do{
+        PROFILE_SCOPE("frame");
+#ifdef ENABLE_PROFILER
+        GetGpuProfiler().BeginFrame();
+#endif
+#ifdef TRACK_HEAP_ALLOCATIONS
+        size_t frame_allocations = heapAllocationCount.load(std::memory_order_relaxed);
+#endif
+        {
+            PROFILE_SCOPE("assets");
+            assetLoader.Pump(AssetUploadBudget);
+            textureStreamer.Update();
+        }
+        if (!assets_resident && assetLoader.idle() && textureStreamer.pending_uploads() == 0) {
+            assets_resident = true;
+            LOG_INFO("all assets resident after %.1f ms, %zu KB of textures\n",
+                   MillisecondsSince(startupTime), textureStreamer.resident_bytes() / 1024);
+        }
+
+        //  MVP-        
+        computeMatricesFromInputs();
+        glm::mat4 ProjectionMatrix = getProjectionMatrix();
+        glm::mat4 ViewMatrix = getViewMatrix();
+        glm::mat4 ModelMatrix = glm::mat4(1.0);
+        glm::mat4 MVP = ProjectionMatrix * ViewMatrix * ModelMatrix;
+        int framebuffer_width, framebuffer_height;
+        glfwGetFramebufferSize(window, &framebuffer_width, &framebuffer_height);
+
+        double current_time = glfwGetTime();
+
+        //   
+        if (mouse_left_released && glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS) {
+            mouse_left_pressed = true;
+            mouse_left_released = false;
+        }
+
+        bool fire = false;
+        if (mouse_left_pressed && glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_RELEASE) {
+            mouse_left_pressed = false;
+            mouse_left_released = true;
+            LOG_INFO("create projectile\n");
+            fire = true;
+        }
 
-        glDrawArraysInstanced(GL_TRIANGLES, 0, 8*3, enemyContainer.size());
+        // the simulation thread takes the input with its next step
+        {
+            PROFILE_SCOPE("read");
+            SubmitInput(getCameraPosition(), getCameraDirection(), fire);
+            ReadSimulation(current_time, frame_feedback_events);
+            for (const FeedbackEvent& event : frame_feedback_events) {
+                switch (event.type) {
+                case FeedbackEvent::Step:
+                    projectileFeedback.Step((float)SimulationStep, event.position, MaxProjectileDistance);
+                    break;
+                case FeedbackEvent::Spawn:
+                    projectileFeedback.Spawn(event.slot, event.position, event.velocity);
+                    break;
+                case FeedbackEvent::Kill:
+                    projectileFeedback.Kill(event.slot);
+                    break;
+                }
+            }
 
-        glDisableVertexAttribArray(0);
-        glDisableVertexAttribArray(1);
-        glDisableVertexAttribArray(2);
-        glDisableVertexAttribArray(3);
+#ifndef NDEBUG
+            if (projectilesOnGPU && current_time - feedback_check_time >= 1.0) {
+                feedback_check_time = current_time;
+                CheckProjectileFeedback();
+            }
+#endif
 
-        // Projectiles
-        glUseProgram(programID2);
-        glUniformMatrix4fv(MatrixID2, 1, GL_FALSE, &MVP[0][0]);
+        }
 
-        // Bind our texture in Texture Unit 0
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, Texture);
-        // Set our "myTextureSampler" sampler to use Texture Unit 0
-        glUniform1i(TextureID, 0);
+        {
+            PROFILE_SCOPE("cull");
+            SortEnemies(ViewMatrix);
+            CullInstances(MVP, enemy_radius, projectile_radius);
+            SelectProjectileLods(ViewMatrix, ProjectionMatrix[1][1] * framebuffer_height * 0.5f, projectile_radius);
+        }
 
-        // 1 attribute buffer : projectile_vertex_buffer
-        glEnableVertexAttribArray(0);
-        glBindBuffer(GL_ARRAY_BUFFER, projectile_vertex_buffer);
-        glVertexAttribPointer(
-                0,                  // attribute
-                3,                  // size
-                GL_FLOAT,           // type
-                GL_FALSE,           // normalized?
-                0,                  // stride
-                (void*)0            // array buffer offset
-        );
+        // instance data of this frame, visible instances only
+        {
+            PROFILE_SCOPE("pack");
+            instanceStream.BeginFrame();
+            if (EnemyInstance* records = enemyInstances.Begin(instanceStream, enemyVisibleCount)) {
+                jobs.ParallelFor(enemyVisibleCount, SimulationChunk, [records](size_t begin, size_t end) {
+                    for (size_t i = begin; i < end; ++i) {
+                        uint32_t enemy = enemyVisible[i];
+                        records[i].quaternion = drawState.enemy_quaternion[enemy];
+                        records[i].position = drawState.enemy_pos[enemy];
+                    }
+                });
+            }
+            if (projectilesOnGPU) {
+                // the records are already in the feedback buffer
+            } else {
+                vec3* records[ProjectileLodCount];
+                bool mapped = true;
+                for (int lod = 0; lod < ProjectileLodCount; ++lod) {
+                    records[lod] = projectileInstances[lod].Begin(instanceStream, projectileLodInstances[lod]);
+                    mapped = mapped && records[lod] != nullptr;
+                }
+                for (size_t i = 0; mapped && i < projectileVisibleCount; ++i) {
+                    *records[projectileLod[i]]++ = drawState.projectile_pos[projectileVisible[i]];
+                }
+            }
+            PROFILE_GPU_BEGIN("upload");
+            if (!instanceStream.Submit()) {
+                LOG_WARNING("instance data lost, skipping the frame's instances\n");
+                enemyInstances.Discard();
+                for (int lod = 0; lod < ProjectileLodCount; ++lod) {
+                    projectileInstances[lod].Discard();
+                }
+            }
+            PROFILE_GPU_END();
+        }
 
-        // 2 attribute buffer : projectile_position_buffer
-        glEnableVertexAttribArray(1);
-        glBindBuffer(GL_ARRAY_BUFFER, projectile_position_buffer);
-        glVertexAttribPointer(
-                1,                  // attribute
-                3,                  // size
-                GL_FLOAT,           // type
-                GL_FALSE,           // normalized?
-                0,                  // stride
-                (void*)0            // array buffer offset
-        );
 
-        // 3 attribute buffer : projectile_uvbuffer
-        glEnableVertexAttribArray(2);
-        glBindBuffer(GL_ARRAY_BUFFER, projectile_uvbuffer);
-        glVertexAttribPointer(
-                2,                  // attribute
-                2,                  // size
-                GL_FLOAT,           // type
-                GL_FALSE,           // normalized?
-                0,                  // stride
-                (void*)0            // array buffer offset
-        );
+        {
+            PROFILE_SCOPE("draw");
+			// Clear the screen
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        glVertexAttribDivisor(0, 0);
-        glVertexAttribDivisor(1, 1);
-        glVertexAttribDivisor(2, 0);
+            int region = instanceStream.region_index();
 
-        glDrawArraysInstanced(GL_TRIANGLES, 0, vertices_proj.size(), projectileContainer.size());
+			// Enemies
+            PROFILE_GPU_BEGIN("enemies");
+            enemyDraw.Bind(region, MVP);
+            glDrawElementsInstanced(GL_TRIANGLES, enemyMesh.indices.size(), GL_UNSIGNED_INT, (void*)0, enemyInstances.count());
+            PROFILE_GPU_END();
 
-        glDisableVertexAttribArray(0);
-        glDisableVertexAttribArray(1);
-        glDisableVertexAttribArray(2);
+            // Projectiles, one draw per level of detail
+            // Bind our texture in Texture Unit 0
+            glActiveTexture(GL_TEXTURE0);
+            if (projectileTexture >= 0) {
+                glBindTexture(GL_TEXTURE_2D, textureStreamer.id(projectileTexture));
+                textureStreamer.Touch(projectileTexture);
+            } else {
+                glBindTexture(GL_TEXTURE_2D, placeholder_texture);
+            }
+            PROFILE_GPU_BEGIN("projectiles");
+            for (size_t lod = 0; lod < projectileDraws.size() && lod < projectileLods.size(); ++lod) {
+                // on the GPU every record is drawn, free ones collapse to a point
+                GLsizei instances = projectilesOnGPU ? (GLsizei)projectileFeedback.size() : (GLsizei)projectileInstances[lod].count();
+                if (instances == 0) {
+                    continue;
+                }
+                projectileDraws[lod].Bind(projectilesOnGPU ? projectileFeedback.current_index() : region, MVP);
+                glDrawElementsInstanced(GL_TRIANGLES, projectileLods[lod].index_count, GL_UNSIGNED_INT,
+                                        (void*)(projectileLods[lod].first_index * sizeof(uint32_t)), instances);
+#ifdef REPORT_CULLING
+                projectile_triangles += instances * projectileLods[lod].index_count / 3;
+                projectile_triangles_full += instances * projectileLods[0].index_count / 3;
+#endif
+            }
 
-		// Swap buffers
-		glfwSwapBuffers(window);
-		glfwPollEvents();
+            PROFILE_GPU_END();
 
-        CheckCollision();
-        DeleteDestroyedObject(enemyContainer);
-        DeleteDestroyedObject(projectileContainer);
-        DeleteFarProjectiles();
+            instanceStream.EndFrame();
+        }
 
+        {
+            PROFILE_SCOPE("swap");
+			// Swap buffers
+			glfwSwapBuffers(window);
+			glfwPollEvents();
+        }
+        if (first_frame) {
+            first_frame = false;
+            LOG_INFO("first frame after %.1f ms\n", MillisecondsSince(startupTime));
+        }
 
+#ifdef TRACK_HEAP_ALLOCATIONS
+        frame_allocations = heapAllocationCount.load(std::memory_order_relaxed) - frame_allocations;
+        // the loader thread allocates until the assets are resident
+        if (frame_index >= AllocationWarmupFrames && assets_resident && frame_allocations != 0) {
+            LOG_WARNING("frame %d: %zu heap allocations\n", frame_index, frame_allocations);
+        }
+        frame_index += 1;
+#endif
+
+#ifdef COUNT_GL_CALLS
+        // average over a second
+        gl_call_frames += 1;
+        if (current_time - gl_call_report_time >= 1.0) {
+            LOG_INFO("GL calls per frame: %lu\n", GLCallCount() / gl_call_frames);
+            GLCallCount() = 0;
+            gl_call_frames = 0;
+            gl_call_report_time = current_time;
+        }
+#endif
+
+#ifdef ENABLE_PROFILER
+        // summary of the last ProfileWindow samples, every second
+        if (current_time - profile_report_time >= 1.0) {
+            GetProfiler().Summarize();
+            GetProfiler().PrintSummary();
+            printf("(%d job threads)\n", jobs.thread_count());
+            profile_report_time = current_time;
+        }
+#endif
+
+#ifdef REPORT_CULLING
+        // average over a second
+        cull_frames += 1;
+        enemies_visible += enemyVisibleCount;
+        enemies_total += enemyDrawOrder.size();
+        projectiles_visible += projectileVisibleCount;
+        projectiles_total += drawState.projectile_pos.size();
+        if (current_time - cull_report_time >= 1.0) {
+            size_t saved_bytes = enemyInstances.Bytes(enemies_total - enemies_visible) +
+                                 projectileInstances[0].Bytes(projectiles_total - projectiles_visible);
+            LOG_INFO("visible per frame: enemies %zu/%zu, projectiles %zu/%zu, %zu upload bytes saved\n",
+                   enemies_visible / cull_frames, enemies_total / cull_frames,
+                   projectiles_visible / cull_frames, projectiles_total / cull_frames,
+                   saved_bytes / cull_frames);
+            LOG_INFO("projectile triangles per frame: %zu, %zu without levels of detail\n",
+                   projectile_triangles / cull_frames, projectile_triangles_full / cull_frames);
+            cull_frames = 0;
+            enemies_visible = enemies_total = 0;
+            projectiles_visible = projectiles_total = 0;
+            projectile_triangles = projectile_triangles_full = 0;
+            cull_report_time = current_time;
+        }
+#endif
 	} // Check if the ESC key was pressed or the window was closed
 	while( glfwGetKey(window, GLFW_KEY_ESCAPE ) != GLFW_PRESS &&
 		   glfwWindowShouldClose(window) == 0 );
 
+    StopSimulation();
+    assetLoader.Stop();
+    jobs.Stop();
+    GetAsyncLogger().Stop();
+#ifdef ENABLE_PROFILER
+    if (GetProfiler().WriteChromeTrace("frame_trace.json")) {
+        printf("trace written to frame_trace.json\n");
+    }
+    GetGpuProfiler().Destroy();
+#endif
+
 	// Cleanup VBO and shader
 	glDeleteBuffers(1, &enemy_vertex_buffer);
-    glDeleteBuffers(1, &enemy_position_buffer);
-    glDeleteBuffers(1, &enemy_rotation_axis_buffer);
-    glDeleteBuffers(1, &enemy_color_buffer);
+    glDeleteBuffers(1, &enemy_index_buffer);
 
     glDeleteBuffers(1, &projectile_vertex_buffer);
-    glDeleteBuffers(1, &projectile_position_buffer);
-    glDeleteBuffers(1, &projectile_uvbuffer);
+    glDeleteBuffers(1, &projectile_index_buffer);
+    instanceStream.Destroy();
 
 	glDeleteProgram(programID1);
 	glDeleteProgram(programID2);
-    glDeleteTextures(1, &Texture);
-	glDeleteVertexArrays(1, &VertexArrayID);
+    glDeleteTextures(1, &placeholder_texture);
+    textureStreamer.Destroy();
+    enemyDraw.Destroy();
+    for (Drawable& projectileDraw : projectileDraws) {
+        projectileDraw.Destroy();
+    }
+    projectileFeedback.Destroy();
 
 	// Close OpenGL window and terminate GLFW
 	glfwTerminate();
@@ -0,0 +1,135 @@
+#ifndef INPUT_LOG_HPP
+#define INPUT_LOG_HPP
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+
+// A shot fired by the player, from where the camera was at the click.
+struct Shot {
+    glm::vec3 origin;
+    glm::vec3 direction;
+};
+
+static_assert(sizeof(Shot) == 6 * sizeof(float), "shots are written as 6 floats");
+
+// Everything the simulation takes from the player, one record per step,
+// so a session can be replayed without a window. The enemies come from
+// the wave spawner, its seed is in the header. Version 1 logs were
+// recorded with rand() placing them.
+// A record is the camera position (3 floats), the number of shots fired
+// in the step (uint8) and the shots (6 floats each).
+struct InputLogHeader {
+    char magic[4];   // "HWIL"
+    uint32_t version;
+    uint32_t seed;
+    float step;      // seconds per simulation step
+};
+
+const uint32_t InputLogVersion = 2;
+const size_t MaxShotsPerStep = 255;
+
+class InputLogWriter {
+public:
+    ~InputLogWriter() { Close(); }
+
+    bool Open(const char* log_path, uint32_t seed, float step){
+        Close();
+        file = fopen(log_path, "wb");
+        if (file == nullptr) {
+            fprintf(stderr, "%s: can't write the input log\n", log_path);
+            return false;
+        }
+        path = log_path;
+        InputLogHeader header;
+        memcpy(header.magic, "HWIL", 4);
+        header.version = InputLogVersion;
+        header.seed = seed;
+        header.step = step;
+        if (fwrite(&header, sizeof(header), 1, file) != 1) {
+            Fail();
+            return false;
+        }
+        return true;
+    }
+
+    bool is_open() const { return file != nullptr; }
+
+    // Shots past MaxShotsPerStep are dropped.
+    void Write(const glm::vec3& camera, const std::vector<Shot>& shots){
+        if (file == nullptr) {
+            return;
+        }
+        uint8_t count = (uint8_t)std::min(shots.size(), MaxShotsPerStep);
+        bool ok = fwrite(&camera, sizeof(float), 3, file) == 3 &&
+                  fwrite(&count, 1, 1, file) == 1 &&
+                  fwrite(shots.data(), sizeof(Shot), count, file) == count;
+        if (!ok) {
+            Fail();
+        }
+    }
+
+    void Close(){
+        if (file != nullptr && fclose(file) != 0) {
+            fprintf(stderr, "%s: can't write the input log\n", path);
+        }
+        file = nullptr;
+    }
+
+private:
+    // The session goes on without recording.
+    void Fail(){
+        fprintf(stderr, "%s: can't write the input log, recording stopped\n", path);
+        fclose(file);
+        file = nullptr;
+    }
+
+    FILE* file = nullptr;
+    const char* path = "";
+};
+
+class InputLogReader {
+public:
+    ~InputLogReader() {
+        if (file != nullptr) {
+            fclose(file);
+        }
+    }
+
+    bool Open(const char* log_path){
+        file = fopen(log_path, "rb");
+        if (file == nullptr) {
+            fprintf(stderr, "%s: can't open the input log\n", log_path);
+            return false;
+        }
+        if (fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.magic, "HWIL", 4) != 0 ||
+            header.version != InputLogVersion) {
+            fprintf(stderr, "%s: not an input log of this version\n", log_path);
+            return false;
+        }
+        return true;
+    }
+
+    uint32_t seed() const { return header.seed; }
+    float step() const { return header.step; }
+
+    // Input of the next step, false at the end of the log. A record cut
+    // off at the end counts as the end.
+    bool Next(glm::vec3& camera, std::vector<Shot>& shots){
+        uint8_t count;
+        if (fread(&camera, sizeof(float), 3, file) != 3 || fread(&count, 1, 1, file) != 1) {
+            return false;
+        }
+        shots.resize(count);
+        return fread(shots.data(), sizeof(Shot), count, file) == count;
+    }
+
+private:
+    FILE* file = nullptr;
+    InputLogHeader header;
+};
+
+#endif
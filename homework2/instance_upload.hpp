@@ -0,0 +1,94 @@
+#ifndef INSTANCE_UPLOAD_HPP
+#define INSTANCE_UPLOAD_HPP
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include "stream_buffer.hpp"
+#include "async_log.hpp"
+
+// Number of float components of an attribute type, only the types the
+// shaders actually use are defined.
+template <typename T> struct AttributeType;
+template <> struct AttributeType<float>     { static const GLint components = 1; };
+template <> struct AttributeType<glm::vec2> { static const GLint components = 2; };
+template <> struct AttributeType<glm::vec3> { static const GLint components = 3; };
+template <> struct AttributeType<glm::vec4> { static const GLint components = 4; };
+
+// Per-instance data of one draw, written as interleaved Record structs into
+// its own slot of a StreamBuffer. Byte sizes and strides come from the
+// types, and a frame never writes more than the capacity given to Init.
+template <typename Record>
+class InstanceUpload {
+public:
+    struct Attribute {
+        GLuint location;
+        GLint components;
+        size_t offset;
+    };
+
+    // Reserves the slot for max_instances records, call before stream.Init.
+    // upload_name is logged by pointer, it must be a literal or static.
+    void Init(const char* upload_name, size_t max_instances, StreamBuffer& stream){
+        name = upload_name;
+        capacity = max_instances;
+        slot = stream.Reserve(Bytes(max_instances));
+        attributes.clear();
+    }
+
+    // Field is the type of the member at offset, e.g.
+    // AddAttribute<glm::vec3>(2, offsetof(EnemyInstance, position))
+    template <typename Field>
+    void AddAttribute(GLuint location, size_t offset){
+        Attribute attribute = {location, AttributeType<Field>::components, offset};
+        attributes.push_back(attribute);
+    }
+
+    static GLsizeiptr Bytes(size_t instances){
+        return (GLsizeiptr)(instances * sizeof(Record));
+    }
+
+    // Room for count records in this frame's region of the stream.
+    // Returns nullptr when count is over capacity or the region isn't
+    // mapped, the draw is skipped then (count() is 0).
+    Record* Begin(StreamBuffer& stream, size_t count){
+        instances = 0;
+        if (count > capacity) {
+            LOG_WARNING("%s: %zu instances, capacity is %zu\n", name, count, capacity);
+            return nullptr;
+        }
+        Record* records = (Record*)stream.Write(slot);
+        if (records == nullptr) {
+            LOG_WARNING("%s: stream buffer is not mapped\n", name);
+            return nullptr;
+        }
+        instances = count;
+        return records;
+    }
+
+    // Points the instance attributes of the bound VAO at the slot in the
+    // given region. The stream buffer must be bound to GL_ARRAY_BUFFER.
+    void SetPointers(const StreamBuffer& stream, int region) const {
+        GLintptr offset = stream.Offset(region, slot);
+        for (const Attribute& attribute : attributes) {
+            glEnableVertexAttribArray(attribute.location);
+            glVertexAttribPointer(attribute.location, attribute.components, GL_FLOAT, GL_FALSE,
+                                  sizeof(Record), (void*)(offset + attribute.offset));
+            glVertexAttribDivisor(attribute.location, 1);
+        }
+    }
+
+    size_t count() const { return instances; }
+
+    // Drops this frame's records, e.g. when the stream lost them.
+    void Discard() { instances = 0; }
+
+private:
+    const char* name = "";
+    size_t capacity = 0;
+    size_t instances = 0;
+    GLintptr slot = 0;
+    std::vector<Attribute> attributes;
+};
+
+#endif
@@ -0,0 +1,181 @@
+#ifndef JOB_SYSTEM_HPP
+#define JOB_SYSTEM_HPP
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+// Worker threads for the data parallel phases of the frame. ParallelFor
+// cuts a range into chunks and deals them out to one queue per thread,
+// the calling thread included. A thread runs its own chunks first and
+// then steals from the others, so a slow chunk doesn't hold up the rest
+// of its queue. The caller returns once every chunk has run.
+//
+// Jobs are plain structs in fixed queues, submitting a phase doesn't
+// touch the heap. Several threads may submit at once, a submitter waiting
+// for its chunks helps with the others' too. Bodies must not call
+// ParallelFor themselves.
+class JobSystem {
+public:
+    JobSystem() {}
+    ~JobSystem() { Stop(); }
+
+    // worker_count < 0: one worker per core besides the calling thread.
+    void Start(int worker_count = -1){
+        if (worker_count < 0) {
+            worker_count = std::max(1, (int)std::thread::hardware_concurrency()) - 1;
+        }
+        stopping = false;
+        generation = 0;
+        queues = std::vector<Queue>(worker_count + 1);
+        for (int i = 0; i < worker_count; ++i) {
+            workers.push_back(std::thread(&JobSystem::Run, this, i + 1));
+        }
+    }
+
+    void Stop(){
+        if (workers.empty()) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+        workers.clear();
+    }
+
+    int thread_count() const { return (int)workers.size() + 1; }
+    size_t max_chunks() const { return (size_t)thread_count() * MaxChunksPerThread; }
+
+    // Up to MaxChunksPerThread chunks per thread, none under min_chunk
+    // items. Chunk k is [k * size, min((k + 1) * size, count)).
+    size_t ChunkSize(size_t count, size_t min_chunk) const {
+        size_t chunks = max_chunks();
+        return std::max(std::max(min_chunk, (size_t)1), (count + chunks - 1) / chunks);
+    }
+
+    size_t ChunkCount(size_t count, size_t min_chunk) const {
+        size_t size = ChunkSize(count, min_chunk);
+        return (count + size - 1) / size;
+    }
+
+    // Calls body(begin, end) for every chunk of [0, count). A single chunk
+    // runs inline.
+    template <typename Body>
+    void ParallelFor(size_t count, size_t min_chunk, const Body& body){
+        size_t size = ChunkSize(count, min_chunk);
+        size_t chunks = (count + size - 1) / size;
+        if (chunks <= 1 || workers.empty()) {
+            if (count > 0) {
+                body(0, count);
+            }
+            return;
+        }
+        std::atomic<size_t> remaining(chunks);
+        for (size_t k = 0; k < chunks; ++k) {
+            Job job = {&JobSystem::Call<Body>, &body, k * size, std::min((k + 1) * size, count), &remaining};
+            Queue& queue = queues[k % queues.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.jobs[queue.tail++ % QueueCapacity] = job;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            generation += 1;
+        }
+        wake.notify_all();
+
+        Job job;
+        while (remaining.load(std::memory_order_acquire) != 0) {
+            if (FindJob(0, job)) {
+                Execute(job);
+            } else {
+                // the last chunks are running on other threads
+                std::this_thread::yield();
+            }
+        }
+    }
+
+private:
+    static const size_t MaxChunksPerThread = 4;
+    static const size_t QueueCapacity = 64;
+
+    struct Job {
+        void (*call)(const void* body, size_t begin, size_t end);
+        const void* body;
+        size_t begin;
+        size_t end;
+        std::atomic<size_t>* remaining; // chunks of the ParallelFor left
+    };
+
+    struct Queue {
+        std::mutex mutex;
+        Job jobs[QueueCapacity];
+        size_t head = 0; // stolen from here
+        size_t tail = 0; // the owner pops here
+    };
+
+    template <typename Body>
+    static void Call(const void* body, size_t begin, size_t end){
+        (*(const Body*)body)(begin, end);
+    }
+
+    void Execute(const Job& job){
+        job.call(job.body, job.begin, job.end);
+        job.remaining->fetch_sub(1, std::memory_order_release);
+    }
+
+    // Own queue first, newest job first, then the oldest job of the others.
+    bool FindJob(size_t self, Job& job){
+        {
+            Queue& own = queues[self];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (own.head != own.tail) {
+                job = own.jobs[--own.tail % QueueCapacity];
+                return true;
+            }
+        }
+        for (size_t i = 1; i < queues.size(); ++i) {
+            Queue& victim = queues[(self + i) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (victim.head != victim.tail) {
+                job = victim.jobs[victim.head++ % QueueCapacity];
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void Run(size_t self){
+        uint64_t seen = 0;
+        Job job;
+        for (;;) {
+            while (FindJob(self, job)) {
+                Execute(job);
+            }
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this, seen]() { return stopping || generation != seen; });
+            if (stopping) {
+                return;
+            }
+            seen = generation;
+        }
+    }
+
+    std::vector<Queue> queues; // 0 belongs to the submitting threads
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    uint64_t generation = 0;
+    bool stopping = false;
+};
+
+#endif
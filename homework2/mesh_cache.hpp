@@ -0,0 +1,154 @@
+#ifndef MESH_CACHE_HPP
+#define MESH_CACHE_HPP
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include "mesh_cooker.hpp"
+#include "mapped_file.hpp"
+#include "../common/hash_bytes.hpp"
+#include "../common/rename_over.hpp"
+
+// Binary cache of a cooked mesh, stored next to its source as
+// "<source>.meshcache": a header followed by the raw vertex and index
+// arrays, so loading it is one mapping and two copies.
+// The cache is only used when the header matches the current source file,
+// the vertex layout and the format version, otherwise the caller cooks the
+// source again and rewrites the cache. The source is compared by size and
+// write time; only when the time differs (a checkout, a copy) are its
+// contents hashed, and a cache whose hash still matches gets the new time.
+struct MeshCacheHeader {
+    char magic[4];          // "MSHC"
+    uint32_t version;
+    uint64_t layout_hash;   // hash of the layout description
+    uint32_t vertex_size;   // sizeof(Vertex)
+    uint32_t vertex_count;
+    uint32_t index_count;
+    uint32_t source_vertices; // unindexed vertex count of the source
+    uint64_t source_hash;
+    uint64_t source_size;
+    int64_t source_write_time;
+};
+
+const uint32_t MeshCacheVersion = 2;
+
+// The source file a cache belongs to.
+struct MeshSource {
+    uint64_t size;
+    int64_t write_time;
+    uint64_t hash; // 0 until it is needed
+};
+
+inline std::string MeshCachePath(const char* source_path){
+    return std::string(source_path) + ".meshcache";
+}
+
+// Hash of the source file contents, 0 if it can't be read.
+inline uint64_t SourceFileHash(const char* source_path){
+    MappedFile source;
+    if (!source.Open(source_path)) {
+        return 0;
+    }
+    return HashBytes(source.data(), source.size());
+}
+
+// False if the source doesn't exist.
+inline bool StatMeshSource(const char* source_path, MeshSource& source){
+    source.hash = 0;
+    return FileStamp(source_path, source.size, source.write_time);
+}
+
+template <typename Vertex>
+bool SaveMeshCache(const char* source_path, const char* layout, MeshSource& source,
+                   const IndexedMesh<Vertex>& mesh, size_t source_vertices){
+    if (source.hash == 0 && (source.hash = SourceFileHash(source_path)) == 0) {
+        return false;
+    }
+    MeshCacheHeader header;
+    memcpy(header.magic, "MSHC", 4);
+    header.version = MeshCacheVersion;
+    header.layout_hash = HashBytes(layout, strlen(layout));
+    header.vertex_size = sizeof(Vertex);
+    header.vertex_count = (uint32_t)mesh.vertices.size();
+    header.index_count = (uint32_t)mesh.indices.size();
+    header.source_vertices = (uint32_t)source_vertices;
+    header.source_hash = source.hash;
+    header.source_size = source.size;
+    header.source_write_time = source.write_time;
+
+    // written under a temporary name and renamed, a crash never leaves a
+    // half written cache behind
+    std::string path = MeshCachePath(source_path);
+    std::string tmp_path = path + ".tmp";
+    FILE* f = fopen(tmp_path.c_str(), "wb");
+    if (f == nullptr) {
+        fprintf(stderr, "%s: can't write %s\n", source_path, tmp_path.c_str());
+        return false;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+    if (ok && !mesh.vertices.empty()) {
+        ok = fwrite(mesh.vertices.data(), sizeof(Vertex), mesh.vertices.size(), f) == mesh.vertices.size();
+    }
+    if (ok && !mesh.indices.empty()) {
+        ok = fwrite(mesh.indices.data(), sizeof(uint32_t), mesh.indices.size(), f) == mesh.indices.size();
+    }
+    ok = fclose(f) == 0 && ok;
+    if (!ok || !RenameOver(tmp_path.c_str(), path.c_str())) {
+        fprintf(stderr, "%s: can't write %s\n", source_path, path.c_str());
+        remove(tmp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+// layout describes Vertex, e.g. "position:vec3 uv:vec2". Returns false if
+// there is no valid cache for this source and layout.
+template <typename Vertex>
+bool LoadMeshCache(const char* source_path, const char* layout, MeshSource& source,
+                   IndexedMesh<Vertex>& mesh, size_t& source_vertices){
+    MappedFile file;
+    if (!file.Open(MeshCachePath(source_path).c_str())) {
+        return false;
+    }
+    MeshCacheHeader header;
+    if (file.size() < sizeof(header)) {
+        return false;
+    }
+    memcpy(&header, file.data(), sizeof(header));
+    if (memcmp(header.magic, "MSHC", 4) != 0 ||
+        header.version != MeshCacheVersion ||
+        header.layout_hash != HashBytes(layout, strlen(layout)) ||
+        header.vertex_size != sizeof(Vertex) ||
+        header.source_size != source.size) {
+        return false;
+    }
+    bool touched = header.source_write_time != source.write_time;
+    if (touched) {
+        if (source.hash == 0) {
+            source.hash = SourceFileHash(source_path);
+        }
+        if (source.hash == 0 || header.source_hash != source.hash) {
+            return false;
+        }
+    }
+    size_t vertex_bytes = (size_t)header.vertex_count * sizeof(Vertex);
+    size_t index_bytes = (size_t)header.index_count * sizeof(uint32_t);
+    if (file.size() != sizeof(header) + vertex_bytes + index_bytes) {
+        fprintf(stderr, "%s: truncated mesh cache\n", source_path);
+        return false;
+    }
+    const uint8_t* p = file.data() + sizeof(header);
+    mesh.vertices.resize(header.vertex_count);
+    memcpy(mesh.vertices.data(), p, vertex_bytes);
+    mesh.indices.resize(header.index_count);
+    memcpy(mesh.indices.data(), p + vertex_bytes, index_bytes);
+    source_vertices = header.source_vertices;
+    if (touched) {
+        file.Close();
+        SaveMeshCache(source_path, layout, source, mesh, source_vertices);
+    }
+    return true;
+}
+
+#endif
@@ -0,0 +1,230 @@
+#ifndef MESH_COOKER_HPP
+#define MESH_COOKER_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include "../common/hash_bytes.hpp"
+
+// Turns a triangle soup (3 vertices per triangle, as loadOBJ returns it)
+// into an indexed mesh:
+//  1. identical vertices are welded into one (compared bytewise, so Vertex
+//     must be a plain struct of floats without padding),
+//  2. triangles are reordered for the post-transform vertex cache
+//     (Tom Forsyth, "Linear-Speed Vertex Cache Optimisation"),
+//  3. vertices are reordered by first use so vertex fetch walks forward.
+
+template <typename Vertex>
+struct IndexedMesh {
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+};
+
+// Average cache miss ratio: transformed vertices per triangle with a FIFO
+// cache of cache_size entries. 3.0 is no reuse at all, an unindexed draw.
+inline float ComputeACMR(const std::vector<uint32_t>& indices, size_t cache_size = 16){
+    if (indices.empty()) {
+        return 0.0f;
+    }
+    std::vector<uint32_t> fifo(cache_size, UINT32_MAX);
+    size_t head = 0;
+    size_t misses = 0;
+    for (uint32_t index : indices) {
+        if (std::find(fifo.begin(), fifo.end(), index) == fifo.end()) {
+            fifo[head] = index;
+            head = (head + 1) % cache_size;
+            misses += 1;
+        }
+    }
+    return float(misses) / float(indices.size() / 3);
+}
+
+// Open addressing over the vertex bytes: table holds indices into
+// mesh.vertices, at least twice as many slots as input vertices.
+template <typename Vertex>
+void WeldVertices(const std::vector<Vertex>& triangles, IndexedMesh<Vertex>& mesh){
+    size_t slot_count = 16;
+    while (slot_count < triangles.size() * 2) {
+        slot_count *= 2;
+    }
+    std::vector<uint32_t> table(slot_count, UINT32_MAX);
+    mesh.vertices.clear();
+    mesh.vertices.reserve(triangles.size());
+    mesh.indices.resize(triangles.size());
+    for (size_t i = 0; i < triangles.size(); ++i) {
+        const Vertex& vertex = triangles[i];
+        size_t slot = (size_t)HashBytes(&vertex, sizeof(Vertex)) & (slot_count - 1);
+        while (table[slot] != UINT32_MAX && memcmp(&mesh.vertices[table[slot]], &vertex, sizeof(Vertex)) != 0) {
+            slot = (slot + 1) & (slot_count - 1);
+        }
+        if (table[slot] == UINT32_MAX) {
+            table[slot] = (uint32_t)mesh.vertices.size();
+            mesh.vertices.push_back(vertex);
+        }
+        mesh.indices[i] = table[slot];
+    }
+}
+
+namespace forsyth {
+
+const int CacheSize = 32;
+const float CacheDecayPower = 1.5f;
+const float LastTriScore = 0.75f;
+const float ValenceBoostScale = 2.0f;
+const float ValenceBoostPower = 0.5f;
+
+inline float VertexScore(int cache_position, int active_triangles){
+    if (active_triangles == 0) {
+        // no triangle needs this vertex anymore
+        return -1.0f;
+    }
+    float score = 0.0f;
+    if (cache_position >= 0) {
+        if (cache_position < 3) {
+            // used by the last triangle, a fixed score so the next one
+            // doesn't just continue the strip
+            score = LastTriScore;
+        } else {
+            float scale = 1.0f / (CacheSize - 3);
+            score = std::pow(1.0f - (cache_position - 3) * scale, CacheDecayPower);
+        }
+    }
+    // favour vertices with few triangles left, it gets rid of them
+    score += ValenceBoostScale * std::pow((float)active_triangles, -ValenceBoostPower);
+    return score;
+}
+
+} // namespace forsyth
+
+inline void OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertex_count){
+    using namespace forsyth;
+    size_t triangle_count = indices.size() / 3;
+    if (triangle_count == 0) {
+        return;
+    }
+
+    // triangles of every vertex
+    std::vector<int> active(vertex_count, 0);
+    for (uint32_t index : indices) {
+        active[index] += 1;
+    }
+    std::vector<uint32_t> first_triangle(vertex_count + 1, 0);
+    for (size_t v = 0; v < vertex_count; ++v) {
+        first_triangle[v + 1] = first_triangle[v] + active[v];
+    }
+    std::vector<uint32_t> vertex_triangles(indices.size());
+    std::vector<uint32_t> fill(first_triangle.begin(), first_triangle.end() - 1);
+    for (size_t t = 0; t < triangle_count; ++t) {
+        for (int k = 0; k < 3; ++k) {
+            vertex_triangles[fill[indices[t * 3 + k]]++] = (uint32_t)t;
+        }
+    }
+
+    std::vector<int> cache_position(vertex_count, -1);
+    std::vector<float> vertex_score(vertex_count);
+    for (size_t v = 0; v < vertex_count; ++v) {
+        vertex_score[v] = VertexScore(-1, active[v]);
+    }
+    std::vector<float> triangle_score(triangle_count);
+    std::vector<uint8_t> added(triangle_count, 0);
+    for (size_t t = 0; t < triangle_count; ++t) {
+        triangle_score[t] = vertex_score[indices[t * 3]] + vertex_score[indices[t * 3 + 1]] + vertex_score[indices[t * 3 + 2]];
+    }
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    std::vector<uint32_t> cache;
+    std::vector<uint32_t> new_cache;
+    size_t scan_from = 0;
+
+    int best = -1;
+    while (result.size() < indices.size()) {
+        if (best < 0) {
+            // nothing useful in the cache, take the best remaining triangle
+            float best_score = -1.0f;
+            for (size_t t = scan_from; t < triangle_count; ++t) {
+                if (!added[t] && triangle_score[t] > best_score) {
+                    best_score = triangle_score[t];
+                    best = (int)t;
+                }
+            }
+            while (scan_from < triangle_count && added[scan_from]) {
+                scan_from += 1;
+            }
+        }
+
+        added[best] = 1;
+        const uint32_t* tri = &indices[best * 3];
+        result.insert(result.end(), tri, tri + 3);
+
+        // the triangle's vertices move to the front of the cache
+        new_cache.assign(tri, tri + 3);
+        for (uint32_t v : cache) {
+            if (v != tri[0] && v != tri[1] && v != tri[2]) {
+                new_cache.push_back(v);
+            }
+        }
+        for (int k = 0; k < 3; ++k) {
+            uint32_t v = tri[k];
+            active[v] -= 1;
+            uint32_t* list = &vertex_triangles[first_triangle[v]];
+            uint32_t* list_end = list + active[v] + 1;
+            std::remove(list, list_end, (uint32_t)best);
+        }
+
+        // rescore everything that was in the cache, pick the next triangle
+        // among the triangles of the cached vertices
+        best = -1;
+        float best_score = -1.0f;
+        for (size_t i = 0; i < new_cache.size(); ++i) {
+            uint32_t v = new_cache[i];
+            cache_position[v] = i < (size_t)CacheSize ? (int)i : -1;
+            vertex_score[v] = VertexScore(cache_position[v], active[v]);
+        }
+        for (size_t i = 0; i < new_cache.size(); ++i) {
+            uint32_t v = new_cache[i];
+            for (int k = 0; k < active[v]; ++k) {
+                uint32_t t = vertex_triangles[first_triangle[v] + k];
+                triangle_score[t] = vertex_score[indices[t * 3]] + vertex_score[indices[t * 3 + 1]] + vertex_score[indices[t * 3 + 2]];
+                if (triangle_score[t] > best_score) {
+                    best_score = triangle_score[t];
+                    best = (int)t;
+                }
+            }
+        }
+        if (new_cache.size() > (size_t)CacheSize) {
+            new_cache.resize(CacheSize);
+        }
+        cache.swap(new_cache);
+    }
+    indices.swap(result);
+}
+
+// Renumbers the vertices in order of first use by the index buffer.
+template <typename Vertex>
+void ReorderVerticesByFirstUse(IndexedMesh<Vertex>& mesh){
+    std::vector<uint32_t> remap(mesh.vertices.size(), UINT32_MAX);
+    std::vector<Vertex> vertices;
+    vertices.reserve(mesh.vertices.size());
+    for (uint32_t& index : mesh.indices) {
+        if (remap[index] == UINT32_MAX) {
+            remap[index] = (uint32_t)vertices.size();
+            vertices.push_back(mesh.vertices[index]);
+        }
+        index = remap[index];
+    }
+    mesh.vertices.swap(vertices);
+}
+
+template <typename Vertex>
+IndexedMesh<Vertex> CookMesh(const std::vector<Vertex>& triangles){
+    IndexedMesh<Vertex> mesh;
+    WeldVertices(triangles, mesh);
+    OptimizeVertexCache(mesh.indices, mesh.vertices.size());
+    ReorderVerticesByFirstUse(mesh);
+    return mesh;
+}
+
+#endif
@@ -0,0 +1,129 @@
+#ifndef MESH_LOD_HPP
+#define MESH_LOD_HPP
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include "mesh_cooker.hpp"
+
+// Levels of detail of a cooked mesh, built at load time by vertex
+// clustering: positions are snapped to a grid, the vertices of a cell are
+// merged into one at their average position and triangles that lose an
+// edge disappear. Coarser grids give the next levels.
+// All levels share one vertex and one index buffer, the indices of a level
+// already point at its own vertices, so a level is just a range of indices.
+// Vertex needs a glm::vec3 position member.
+
+struct MeshLod {
+    uint32_t first_index;
+    uint32_t index_count;
+};
+
+template <typename Vertex>
+IndexedMesh<Vertex> ClusterVertices(const IndexedMesh<Vertex>& mesh, glm::vec3 origin, float cell_size){
+    IndexedMesh<Vertex> result;
+    std::unordered_map<uint64_t, uint32_t> cells;
+    std::vector<uint32_t> remap(mesh.vertices.size());
+    std::vector<uint32_t> members;
+    for (size_t i = 0; i < mesh.vertices.size(); ++i) {
+        glm::vec3 cell = glm::floor((mesh.vertices[i].position - origin) / cell_size);
+        uint64_t key = (uint64_t)((uint32_t)(int)cell.x & 0x1FFFFF) |
+                       (uint64_t)((uint32_t)(int)cell.y & 0x1FFFFF) << 21 |
+                       (uint64_t)((uint32_t)(int)cell.z & 0x1FFFFF) << 42;
+        auto found = cells.find(key);
+        if (found == cells.end()) {
+            found = cells.emplace(key, (uint32_t)result.vertices.size()).first;
+            result.vertices.push_back(mesh.vertices[i]);
+            result.vertices.back().position = glm::vec3(0.0f);
+            members.push_back(0);
+        }
+        remap[i] = found->second;
+        result.vertices[found->second].position += mesh.vertices[i].position;
+        members[found->second] += 1;
+    }
+    for (size_t i = 0; i < result.vertices.size(); ++i) {
+        result.vertices[i].position /= (float)members[i];
+    }
+
+    for (size_t t = 0; t + 2 < mesh.indices.size(); t += 3) {
+        uint32_t a = remap[mesh.indices[t]];
+        uint32_t b = remap[mesh.indices[t + 1]];
+        uint32_t c = remap[mesh.indices[t + 2]];
+        if (a != b && b != c && a != c) {
+            result.indices.push_back(a);
+            result.indices.push_back(b);
+            result.indices.push_back(c);
+        }
+    }
+    OptimizeVertexCache(result.indices, result.vertices.size());
+    ReorderVerticesByFirstUse(result);
+    return result;
+}
+
+// Level 0 is the mesh itself, the next levels cluster on grids of 16, 8,
+// 4 and 2 cells across the mesh bounds. A grid is skipped when it doesn't
+// save at least a quarter of the triangles of the previous level, so
+// there may be fewer than max_lods levels.
+const int LodFinestGrid = 4; // log2 of the cells across
+
+template <typename Vertex>
+void BuildMeshLods(const IndexedMesh<Vertex>& mesh, int max_lods, IndexedMesh<Vertex>& combined, std::vector<MeshLod>& lods){
+    combined.vertices = mesh.vertices;
+    combined.indices = mesh.indices;
+    lods.clear();
+    MeshLod base = {0, (uint32_t)mesh.indices.size()};
+    lods.push_back(base);
+    if (mesh.vertices.empty()) {
+        return;
+    }
+
+    glm::vec3 lo = mesh.vertices[0].position;
+    glm::vec3 hi = lo;
+    for (const Vertex& vertex : mesh.vertices) {
+        lo = glm::min(lo, vertex.position);
+        hi = glm::max(hi, vertex.position);
+    }
+    glm::vec3 extent = hi - lo;
+    float size = std::max(extent.x, std::max(extent.y, extent.z));
+    // all vertices in one point, there is no grid to cluster on
+    if (!(size > 0.0f)) {
+        return;
+    }
+
+    for (int grid = LodFinestGrid; grid >= 1 && (int)lods.size() < max_lods; --grid) {
+        float cell_size = size / (float)(1 << grid);
+        // half a cell off the bounds, so symmetric meshes cluster symmetrically
+        IndexedMesh<Vertex> lod = ClusterVertices(mesh, lo - glm::vec3(cell_size * 0.5f), cell_size);
+        if (lod.indices.empty() || lod.indices.size() * 4 > (size_t)lods.back().index_count * 3) {
+            continue;
+        }
+        MeshLod range = {(uint32_t)combined.indices.size(), (uint32_t)lod.indices.size()};
+        uint32_t first_vertex = (uint32_t)combined.vertices.size();
+        combined.vertices.insert(combined.vertices.end(), lod.vertices.begin(), lod.vertices.end());
+        for (uint32_t index : lod.indices) {
+            combined.indices.push_back(first_vertex + index);
+        }
+        lods.push_back(range);
+    }
+}
+
+// Level to draw a sphere of the given radius with, depth in front of the
+// camera: level k + 1 or coarser once its projected radius is under
+// lod_pixels[k] pixels, never coarser than coarsest. pixels_per_unit is
+// the projected size of one unit at distance one.
+inline int SelectLod(float depth, float radius, float pixels_per_unit, const float* lod_pixels, int coarsest){
+    int lod = 0;
+    // inside the sphere or right at the camera it fills the screen
+    if (depth > radius) {
+        float pixels = radius * pixels_per_unit / depth;
+        while (lod < coarsest && pixels < lod_pixels[lod]) {
+            ++lod;
+        }
+    }
+    return lod;
+}
+
+#endif
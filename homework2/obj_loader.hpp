@@ -0,0 +1,323 @@
+#ifndef OBJ_LOADER_HPP
+#define OBJ_LOADER_HPP
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include "mapped_file.hpp"
+#include "job_system.hpp"
+#include "async_log.hpp"
+
+// Drop-in replacement for common/objloader's loadOBJ with the same output:
+// the file is mapped, split into chunks on line boundaries and the chunks
+// are parsed on the job system's threads, then the triangles are expanded
+// into output arrays that are sized once.
+// Like loadOBJ it reads v, vt, vn and triangulated "f v/t/n" records only,
+// flips V for the DDS textures and ignores everything else on a line.
+
+namespace obj {
+
+struct Chunk {
+    const char* begin;
+    const char* end;
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec2> uvs;
+    std::vector<glm::vec3> normals;
+    std::vector<uint32_t> faces; // v, t, n of the 3 corners, 1-based
+    bool ok;
+};
+
+inline bool IsBlank(char c){
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+inline const char* SkipBlanks(const char* p, const char* end){
+    while (p < end && IsBlank(*p)) {
+        ++p;
+    }
+    return p;
+}
+
+inline const char* SkipLine(const char* p, const char* end){
+    const char* eol = (const char*)memchr(p, '\n', end - p);
+    return eol ? eol + 1 : end;
+}
+
+// Fast path for plain decimals whose digits fit a float mantissa and whose
+// power of ten is exact in a float: one multiply or divide of two exact
+// values is correctly rounded, same as strtof. Everything else goes to
+// strtof, so the result always matches the scanf based loader.
+inline bool ParseFloat(const char*& p, const char* end, float& out){
+    static const float Pow10[] = {1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f};
+
+    p = SkipBlanks(p, end);
+    const char* token = p;
+    const char* token_end = p;
+    while (token_end < end && !IsBlank(*token_end) && *token_end != '\n') {
+        ++token_end;
+    }
+    if (token == token_end) {
+        return false;
+    }
+
+    const char* q = token;
+    bool negative = false;
+    if (*q == '-' || *q == '+') {
+        negative = *q == '-';
+        ++q;
+    }
+    uint64_t mantissa = 0;
+    bool any_digit = false;
+    int digits = 0;
+    int exponent = 0;
+    while (q < token_end && *q >= '0' && *q <= '9') {
+        mantissa = mantissa * 10 + (*q - '0');
+        digits += mantissa != 0;
+        any_digit = true;
+        ++q;
+    }
+    if (q < token_end && *q == '.') {
+        ++q;
+        while (q < token_end && *q >= '0' && *q <= '9') {
+            mantissa = mantissa * 10 + (*q - '0');
+            digits += mantissa != 0;
+            any_digit = true;
+            exponent -= 1;
+            ++q;
+        }
+    }
+    if (q < token_end && (*q == 'e' || *q == 'E')) {
+        ++q;
+        bool negative_exponent = false;
+        if (q < token_end && (*q == '-' || *q == '+')) {
+            negative_exponent = *q == '-';
+            ++q;
+        }
+        int e = 0;
+        while (q < token_end && *q >= '0' && *q <= '9' && e < 10000) {
+            e = e * 10 + (*q - '0');
+            ++q;
+        }
+        exponent += negative_exponent ? -e : e;
+    }
+
+    if (q == token_end && any_digit && digits <= 18 && mantissa <= (1u << 24) && exponent >= -10 && exponent <= 10) {
+        float value = (float)mantissa;
+        value = exponent < 0 ? value / Pow10[-exponent] : value * Pow10[exponent];
+        out = negative ? -value : value;
+        p = token_end;
+        return true;
+    }
+
+    char buffer[64];
+    size_t length = token_end - token;
+    if (length >= sizeof(buffer)) {
+        return false;
+    }
+    memcpy(buffer, token, length);
+    buffer[length] = '\0';
+    char* parsed_end;
+    out = strtof(buffer, &parsed_end);
+    if (parsed_end == buffer) {
+        return false;
+    }
+    p = token + (parsed_end - buffer);
+    return true;
+}
+
+inline bool ParseIndex(const char*& p, const char* end, uint32_t& out){
+    if (p == end || *p < '0' || *p > '9') {
+        return false;
+    }
+    uint32_t value = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        value = value * 10 + (*p - '0');
+        ++p;
+    }
+    out = value;
+    return true;
+}
+
+// "v/t/n"
+inline bool ParseCorner(const char*& p, const char* end, uint32_t* corner){
+    p = SkipBlanks(p, end);
+    for (int k = 0; k < 3; ++k) {
+        if (k > 0) {
+            if (p == end || *p != '/') {
+                return false;
+            }
+            ++p;
+        }
+        if (!ParseIndex(p, end, corner[k])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+inline void ParseChunk(Chunk& chunk){
+    const char* p = chunk.begin;
+    const char* end = chunk.end;
+    chunk.ok = true;
+    while (p < end) {
+        p = SkipBlanks(p, end);
+        const char* keyword = p;
+        while (p < end && !IsBlank(*p) && *p != '\n') {
+            ++p;
+        }
+        size_t length = p - keyword;
+
+        if (length == 1 && keyword[0] == 'v') {
+            glm::vec3 v;
+            if (!ParseFloat(p, end, v.x) || !ParseFloat(p, end, v.y) || !ParseFloat(p, end, v.z)) {
+                chunk.ok = false;
+                return;
+            }
+            chunk.positions.push_back(v);
+        } else if (length == 2 && keyword[0] == 'v' && keyword[1] == 't') {
+            glm::vec2 uv;
+            if (!ParseFloat(p, end, uv.x) || !ParseFloat(p, end, uv.y)) {
+                chunk.ok = false;
+                return;
+            }
+            uv.y = -uv.y; // DDS textures are upside down
+            chunk.uvs.push_back(uv);
+        } else if (length == 2 && keyword[0] == 'v' && keyword[1] == 'n') {
+            glm::vec3 n;
+            if (!ParseFloat(p, end, n.x) || !ParseFloat(p, end, n.y) || !ParseFloat(p, end, n.z)) {
+                chunk.ok = false;
+                return;
+            }
+            chunk.normals.push_back(n);
+        } else if (length == 1 && keyword[0] == 'f') {
+            uint32_t face[9];
+            if (!ParseCorner(p, end, face) || !ParseCorner(p, end, face + 3) || !ParseCorner(p, end, face + 6)) {
+                chunk.ok = false;
+                return;
+            }
+            chunk.faces.insert(chunk.faces.end(), face, face + 9);
+        }
+        p = SkipLine(p, end);
+    }
+}
+
+// Expands the faces of a chunk into out[first...], false on a bad index.
+inline bool ExpandChunk(const Chunk& chunk, size_t first,
+                        const std::vector<glm::vec3>& positions, const std::vector<glm::vec2>& uvs,
+                        const std::vector<glm::vec3>& normals,
+                        glm::vec3* out_vertices, glm::vec2* out_uvs, glm::vec3* out_normals){
+    for (size_t i = 0; i < chunk.faces.size(); i += 3) {
+        uint32_t v = chunk.faces[i] - 1;
+        uint32_t t = chunk.faces[i + 1] - 1;
+        uint32_t n = chunk.faces[i + 2] - 1;
+        if (v >= positions.size() || t >= uvs.size() || n >= normals.size()) {
+            return false;
+        }
+        size_t out = first + i / 3;
+        out_vertices[out] = positions[v];
+        out_uvs[out] = uvs[t];
+        out_normals[out] = normals[n];
+    }
+    return true;
+}
+
+// Below this a chunk isn't worth a job.
+const size_t MinChunkBytes = 256 * 1024;
+
+} // namespace obj
+
+// Parses on the threads of jobs, which may be running frame phases at
+// the same time: a chunk is small enough not to hold one up for long.
+inline bool LoadOBJParallel(JobSystem& jobs, const char* path,
+                            std::vector<glm::vec3>& out_vertices,
+                            std::vector<glm::vec2>& out_uvs,
+                            std::vector<glm::vec3>& out_normals){
+    LOG_INFO("Loading OBJ file %s...\n", path);
+
+    MappedFile file;
+    if (!file.Open(path)) {
+        LOG_ERROR("Impossible to open the file ! Are you in the right path ? See Tutorial 1 for details\n");
+        return false;
+    }
+    const char* text = (const char*)file.data();
+    const char* text_end = text + file.size();
+
+    size_t chunk_count = std::min(file.size() / obj::MinChunkBytes + 1, jobs.max_chunks());
+
+    // split on line boundaries
+    std::vector<obj::Chunk> chunks(chunk_count);
+    const char* begin = text;
+    for (size_t i = 0; i < chunk_count; ++i) {
+        const char* end = text_end;
+        if (i + 1 < chunk_count) {
+            end = text + file.size() * (i + 1) / chunk_count;
+            end = end < begin ? begin : obj::SkipLine(end, text_end);
+        }
+        chunks[i].begin = begin;
+        chunks[i].end = end;
+        begin = end;
+    }
+
+    jobs.ParallelFor(chunk_count, 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            obj::ParseChunk(chunks[i]);
+        }
+    });
+
+    // records of the chunks are in file order, their concatenation is the
+    // whole file's, and face indices are already global
+    size_t position_count = 0, uv_count = 0, normal_count = 0, corner_count = 0;
+    for (const obj::Chunk& chunk : chunks) {
+        if (!chunk.ok) {
+            LOG_ERROR("File can't be read by our simple parser :-( Try exporting with other options\n");
+            return false;
+        }
+        position_count += chunk.positions.size();
+        uv_count += chunk.uvs.size();
+        normal_count += chunk.normals.size();
+        corner_count += chunk.faces.size() / 3;
+    }
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec2> uvs;
+    std::vector<glm::vec3> normals;
+    positions.reserve(position_count);
+    uvs.reserve(uv_count);
+    normals.reserve(normal_count);
+    for (const obj::Chunk& chunk : chunks) {
+        positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+        uvs.insert(uvs.end(), chunk.uvs.begin(), chunk.uvs.end());
+        normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+    }
+
+    size_t first_corner = out_vertices.size();
+    out_vertices.resize(first_corner + corner_count);
+    out_uvs.resize(first_corner + corner_count);
+    out_normals.resize(first_corner + corner_count);
+    std::vector<size_t> chunk_first(chunk_count);
+    std::vector<char> chunk_ok(chunk_count);
+    for (size_t i = 0, first = first_corner; i < chunk_count; ++i) {
+        chunk_first[i] = first;
+        first += chunks[i].faces.size() / 3;
+    }
+    jobs.ParallelFor(chunk_count, 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            chunk_ok[i] = obj::ExpandChunk(chunks[i], chunk_first[i], positions, uvs, normals,
+                                           out_vertices.data(), out_uvs.data(), out_normals.data());
+        }
+    });
+    for (size_t i = 0; i < chunk_count; ++i) {
+        if (!chunk_ok[i]) {
+            LOG_ERROR("%s: face index out of range\n", path);
+            out_vertices.resize(first_corner);
+            out_uvs.resize(first_corner);
+            out_normals.resize(first_corner);
+            return false;
+        }
+    }
+    return true;
+}
+
+#endif
@@ -0,0 +1,291 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+// Frame profiler, compiled in when ENABLE_PROFILER is defined before this
+// header is included. Otherwise the PROFILE_ macros expand to nothing and
+// none of the code below exists.
+//
+// PROFILE_SCOPE(name) times the rest of the enclosing block on the CPU,
+// scopes nest. Every thread writes its finished scopes to its own ring
+// buffer, which keeps the newest ProfileRingCapacity of them. A scope
+// costs two clock reads and one store.
+// PROFILE_GPU_BEGIN(name) / PROFILE_GPU_END() time the GL commands in
+// between with a GL_TIME_ELAPSED query. They don't nest, and their results
+// are read two frames later, so the CPU never waits for them.
+// The names must be string literals.
+
+#ifdef ENABLE_PROFILER
+
+#include <GL/glew.h>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+
+const size_t ProfileRingCapacity = 1 << 14; // events per thread
+const int MaxProfileThreads = 64;           // job workers included
+const int MaxProfileScopes = 64;
+const int ProfileWindow = 256;              // samples per scope in the summary
+const int MaxGpuScopes = 16;                // per frame
+
+struct ProfileEvent {
+    const char* name;
+    uint64_t start;    // ns since the profiler started
+    uint64_t duration; // ns
+};
+
+// Written by its thread only. Readers take the events below written, and
+// drop the ones the thread may have overwritten while they were read: a
+// thread that ends more than ProfileRingCapacity scopes between two
+// Summarize calls loses the oldest ones.
+struct ProfileThread {
+    const char* name = nullptr;
+    std::atomic<uint64_t> written{0};
+    uint64_t summarized = 0; // read by Summarize up to here
+    ProfileEvent events[ProfileRingCapacity];
+
+    void Push(const char* event_name, uint64_t start, uint64_t duration){
+        uint64_t n = written.load(std::memory_order_relaxed);
+        ProfileEvent& event = events[n % ProfileRingCapacity];
+        event.name = event_name;
+        event.start = start;
+        event.duration = duration;
+        written.store(n + 1, std::memory_order_release);
+    }
+};
+
+class Profiler {
+public:
+    Profiler() : epoch(std::chrono::steady_clock::now()) {}
+
+    uint64_t Now() const {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+    }
+
+    // nullptr once MaxProfileThreads threads are registered.
+    ProfileThread* Register(const char* name){
+        int index = thread_count.fetch_add(1);
+        if (index >= MaxProfileThreads) {
+            if (index == MaxProfileThreads) {
+                fprintf(stderr, "profiler: more than %d threads, the others aren't profiled\n", MaxProfileThreads);
+            }
+            return nullptr;
+        }
+        threads[index].name = name;
+        return &threads[index];
+    }
+
+    // Takes the events written since the last call into the per-scope
+    // windows. One thread at a time.
+    void Summarize(){
+        int count = std::min(thread_count.load(), MaxProfileThreads);
+        for (int t = 0; t < count; ++t) {
+            ProfileThread& thread = threads[t];
+            uint64_t written = thread.written.load(std::memory_order_acquire);
+            uint64_t first = std::max(thread.summarized, written > ProfileRingCapacity ? written - ProfileRingCapacity : 0);
+            for (uint64_t i = first; i < written; ++i) {
+                ProfileEvent event = thread.events[i % ProfileRingCapacity];
+                if (thread.written.load(std::memory_order_acquire) - i > ProfileRingCapacity) {
+                    continue;
+                }
+                if (ScopeStats* scope = Scope(event.name)) {
+                    scope->samples[scope->count % ProfileWindow] = event.duration * 1e-6f;
+                    scope->count += 1;
+                }
+            }
+            thread.summarized = written;
+        }
+    }
+
+    // p50 and p99 of the last ProfileWindow samples of every scope, in ms.
+    void PrintSummary(){
+        for (int s = 0; s < scope_count; ++s) {
+            ScopeStats& scope = scopes[s];
+            int n = (int)std::min<uint64_t>(scope.count, ProfileWindow);
+            std::copy(scope.samples, scope.samples + n, sorted);
+            std::sort(sorted, sorted + n);
+            printf("%-20s p50 %8.3f ms  p99 %8.3f ms\n", scope.name, sorted[n / 2], sorted[(n * 99) / 100]);
+        }
+    }
+
+    // All events still in the ring buffers, as Chrome trace JSON
+    // (chrome://tracing, Perfetto). Call with the other threads stopped.
+    bool WriteChromeTrace(const char* path) const {
+        FILE* f = fopen(path, "w");
+        if (f == nullptr) {
+            fprintf(stderr, "%s: can't write the trace\n", path);
+            return false;
+        }
+        fprintf(f, "{\"traceEvents\":[\n");
+        bool first = true;
+        int count = std::min(thread_count.load(), MaxProfileThreads);
+        for (int t = 0; t < count; ++t) {
+            const ProfileThread& thread = threads[t];
+            fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                    first ? "" : ",\n", t, thread.name ? thread.name : "thread");
+            first = false;
+            uint64_t written = thread.written.load(std::memory_order_acquire);
+            for (uint64_t i = written > ProfileRingCapacity ? written - ProfileRingCapacity : 0; i < written; ++i) {
+                const ProfileEvent& event = thread.events[i % ProfileRingCapacity];
+                fprintf(f, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                        event.name, t, event.start * 1e-3, event.duration * 1e-3);
+            }
+        }
+        fprintf(f, "\n]}\n");
+        if (fclose(f) != 0) {
+            fprintf(stderr, "%s: can't write the trace\n", path);
+            return false;
+        }
+        return true;
+    }
+
+private:
+    struct ScopeStats {
+        const char* name;
+        float samples[ProfileWindow]; // ms, ring
+        uint64_t count;
+    };
+
+    ScopeStats* Scope(const char* name){
+        for (int s = 0; s < scope_count; ++s) {
+            if (scopes[s].name == name || strcmp(scopes[s].name, name) == 0) {
+                return &scopes[s];
+            }
+        }
+        if (scope_count == MaxProfileScopes) {
+            return nullptr;
+        }
+        ScopeStats& scope = scopes[scope_count++];
+        scope.name = name;
+        scope.count = 0;
+        return &scope;
+    }
+
+    std::chrono::steady_clock::time_point epoch;
+    ProfileThread threads[MaxProfileThreads];
+    std::atomic<int> thread_count{0};
+    ScopeStats scopes[MaxProfileScopes];
+    int scope_count = 0;
+    float sorted[ProfileWindow];
+};
+
+inline Profiler& GetProfiler(){
+    static Profiler profiler;
+    return profiler;
+}
+
+// The calling thread's buffer, registered on first use if PROFILE_THREAD
+// didn't name it.
+inline ProfileThread*& CurrentProfileThread(){
+    thread_local ProfileThread* thread = nullptr;
+    thread_local bool registered = false;
+    if (!registered) {
+        registered = true;
+        thread = GetProfiler().Register(nullptr);
+    }
+    return thread;
+}
+
+inline void ProfileRegisterThread(const char* name){
+    if (ProfileThread* thread = CurrentProfileThread()) {
+        thread->name = name;
+    }
+}
+
+class ProfileScope {
+public:
+    explicit ProfileScope(const char* scope_name) : name(scope_name), start(GetProfiler().Now()) {}
+
+    ~ProfileScope(){
+        if (ProfileThread* thread = CurrentProfileThread()) {
+            thread->Push(name, start, GetProfiler().Now() - start);
+        }
+    }
+
+private:
+    const char* name;
+    uint64_t start;
+};
+
+// GL thread only. Query set f % 2 is filled in frame f and read back at
+// the start of frame f + 2, results not available by then are dropped.
+class GpuProfiler {
+public:
+    void Init(){
+        glGenQueries(2 * MaxGpuScopes, &queries[0][0]);
+        thread = GetProfiler().Register("GPU");
+    }
+
+    void Destroy(){
+        glDeleteQueries(2 * MaxGpuScopes, &queries[0][0]);
+    }
+
+    void BeginFrame(){
+        frame ^= 1;
+        for (int i = 0; i < count[frame]; ++i) {
+            GLuint available = GL_FALSE;
+            glGetQueryObjectuiv(queries[frame][i], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (available && thread != nullptr) {
+                GLuint64 elapsed = 0;
+                glGetQueryObjectui64v(queries[frame][i], GL_QUERY_RESULT, &elapsed);
+                // GL_TIME_ELAPSED has no start time, the CPU side one stands in
+                thread->Push(names[frame][i], cpu_start[frame][i], elapsed);
+            }
+        }
+        count[frame] = 0;
+    }
+
+    void Begin(const char* name){
+        if (active || count[frame] == MaxGpuScopes) {
+            return;
+        }
+        int i = count[frame];
+        names[frame][i] = name;
+        cpu_start[frame][i] = GetProfiler().Now();
+        glBeginQuery(GL_TIME_ELAPSED, queries[frame][i]);
+        active = true;
+    }
+
+    void End(){
+        if (!active) {
+            return;
+        }
+        glEndQuery(GL_TIME_ELAPSED);
+        count[frame] += 1;
+        active = false;
+    }
+
+private:
+    GLuint queries[2][MaxGpuScopes];
+    const char* names[2][MaxGpuScopes];
+    uint64_t cpu_start[2][MaxGpuScopes];
+    int count[2] = {0, 0};
+    int frame = 0;
+    bool active = false;
+    ProfileThread* thread = nullptr;
+};
+
+inline GpuProfiler& GetGpuProfiler(){
+    static GpuProfiler profiler;
+    return profiler;
+}
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profile_scope_, __LINE__)(name)
+#define PROFILE_THREAD(name) ProfileRegisterThread(name)
+#define PROFILE_GPU_BEGIN(name) GetGpuProfiler().Begin(name)
+#define PROFILE_GPU_END() GetGpuProfiler().End()
+
+#else
+
+#define PROFILE_SCOPE(name)
+#define PROFILE_THREAD(name)
+#define PROFILE_GPU_BEGIN(name)
+#define PROFILE_GPU_END()
+
+#endif
+
+#endif
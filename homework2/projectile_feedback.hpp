@@ -0,0 +1,121 @@
+#ifndef PROJECTILE_FEEDBACK_HPP
+#define PROJECTILE_FEEDBACK_HPP
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstddef>
+#include "../common/shader_cache.hpp"
+
+// Projectile state kept on the GPU and advanced by ProjectileMove.vertexshader
+// with transform feedback, from one buffer into the other every frame.
+// Every projectile has a fixed record, its entity slot, so spawns and kills
+// are single record sub-uploads. Projectiles that fly out of range are
+// killed by the shader itself.
+// This is a copy for drawing only: the simulation keeps moving its own
+// projectiles on the CPU, the GPU copy replaces the per-frame upload of
+// their positions and no CPU work.
+class ProjectileFeedback {
+public:
+    struct Record {
+        glm::vec4 position; // xyz, w: 1 alive, 0 free
+        glm::vec4 velocity; // direction * speed
+    };
+
+    bool Init(uint32_t record_count){
+        // linked alone, the varyings are set before linking
+        static const char* const varyings[] = {"out_position", "out_velocity"};
+        const ShaderProgramFiles files = {"ProjectileMove.vertexshader", nullptr, varyings, 2};
+        if (!LoadShaderPrograms(&files, 1, &program)) {
+            return false;
+        }
+        delta_time_location = glGetUniformLocation(program, "DeltaTime");
+        camera_location = glGetUniformLocation(program, "CameraPosition");
+        max_distance_location = glGetUniformLocation(program, "MaxDistance2");
+
+        count = record_count;
+        std::vector<Record> free_records(count);
+        glGenBuffers(2, buffers);
+        glGenVertexArrays(2, vaos);
+        for (int i = 0; i < 2; ++i) {
+            glBindBuffer(GL_ARRAY_BUFFER, buffers[i]);
+            glBufferData(GL_ARRAY_BUFFER, count * sizeof(Record), free_records.data(), GL_DYNAMIC_COPY);
+            glBindVertexArray(vaos[i]);
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(Record), (void*)offsetof(Record, position));
+            glEnableVertexAttribArray(1);
+            glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(Record), (void*)offsetof(Record, velocity));
+        }
+        glBindVertexArray(0);
+        current = 0;
+        return true;
+    }
+
+    void Destroy(){
+        if (program == 0) {
+            return;
+        }
+        glDeleteVertexArrays(2, vaos);
+        glDeleteBuffers(2, buffers);
+        glDeleteProgram(program);
+        program = 0;
+    }
+
+    // Buffer with this frame's state, after Step.
+    GLuint buffer() const { return buffers[current]; }
+    GLuint buffer(int i) const { return buffers[i]; }
+    int current_index() const { return current; }
+    uint32_t size() const { return count; }
+
+    void Spawn(uint32_t slot, glm::vec3 position, glm::vec3 velocity){
+        Record record;
+        record.position = glm::vec4(position, 1.0f);
+        record.velocity = glm::vec4(velocity, 0.0f);
+        glBindBuffer(GL_ARRAY_BUFFER, buffers[current]);
+        glBufferSubData(GL_ARRAY_BUFFER, slot * sizeof(Record), sizeof(Record), &record);
+    }
+
+    void Kill(uint32_t slot){
+        const float free_slot = 0.0f;
+        glBindBuffer(GL_ARRAY_BUFFER, buffers[current]);
+        glBufferSubData(GL_ARRAY_BUFFER, slot * sizeof(Record) + 3 * sizeof(float), sizeof(float), &free_slot);
+    }
+
+    // Moves every live projectile by delta_time into the other buffer,
+    // which becomes the current one.
+    void Step(float delta_time, glm::vec3 camera_position, float max_distance){
+        int next = 1 - current;
+        glUseProgram(program);
+        glUniform1f(delta_time_location, delta_time);
+        glUniform3f(camera_location, camera_position.x, camera_position.y, camera_position.z);
+        glUniform1f(max_distance_location, max_distance * max_distance);
+        glEnable(GL_RASTERIZER_DISCARD);
+        glBindVertexArray(vaos[current]);
+        glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, buffers[next]);
+        glBeginTransformFeedback(GL_POINTS);
+        glDrawArrays(GL_POINTS, 0, count);
+        glEndTransformFeedback();
+        glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+        glDisable(GL_RASTERIZER_DISCARD);
+        current = next;
+    }
+
+    // Reads the current state back, stalls until the GPU is done. Debug only.
+    void Read(std::vector<Record>& records) const {
+        records.resize(count);
+        glBindBuffer(GL_ARRAY_BUFFER, buffers[current]);
+        glGetBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(Record), records.data());
+    }
+
+private:
+    GLuint program = 0;
+    GLint delta_time_location = -1;
+    GLint camera_location = -1;
+    GLint max_distance_location = -1;
+    GLuint buffers[2];
+    GLuint vaos[2];
+    uint32_t count = 0;
+    int current = 0;
+};
+
+#endif
@@ -0,0 +1,202 @@
+#ifndef PROJECTILE_KERNELS_HPP
+#define PROJECTILE_KERNELS_HPP
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <cstddef>
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h>
+#define PROJECTILE_KERNELS_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#define PROJECTILE_SSE2_TARGET
+#define PROJECTILE_AVX2_TARGET
+#else
+#define PROJECTILE_SSE2_TARGET __attribute__((target("sse2")))
+#define PROJECTILE_AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#endif
+
+// Projectile movement in one pass over the store arrays: every position is
+// saved to prev_pos, moved by direction * (speed * delta_time), and
+// out_of_range is set to 1 when it ends up at max_distance or further from
+// the camera (compared squared). The SSE2 and AVX2 kernels treat the vec3
+// arrays as plain float arrays, 4 or 8 projectiles at a time, and give the
+// same results as the scalar one.
+
+static_assert(sizeof(glm::vec3) == 3 * sizeof(float), "vec3 arrays are read as float arrays");
+
+struct ProjectileArrays {
+    glm::vec3* pos;
+    glm::vec3* prev_pos;
+    const glm::vec3* direction;
+    const float* speed;
+    uint8_t* out_of_range;
+    size_t count;
+};
+
+typedef void (*ProjectileKernel)(const ProjectileArrays& arrays, float delta_time, glm::vec3 camera, float max_distance2);
+
+inline void MoveProjectileRange(const ProjectileArrays& a, size_t begin, float delta_time, glm::vec3 camera, float max_distance2){
+    for (size_t i = begin; i < a.count; ++i) {
+        a.prev_pos[i] = a.pos[i];
+        a.pos[i] += a.direction[i] * (a.speed[i] * delta_time);
+        glm::vec3 d = a.pos[i] - camera;
+        a.out_of_range[i] = d.x * d.x + d.y * d.y + d.z * d.z >= max_distance2;
+    }
+}
+
+inline void MoveProjectilesScalar(const ProjectileArrays& a, float delta_time, glm::vec3 camera, float max_distance2){
+    MoveProjectileRange(a, 0, delta_time, camera, max_distance2);
+}
+
+#ifdef PROJECTILE_KERNELS_X86
+// 4 projectiles are 3 registers: x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3
+PROJECTILE_SSE2_TARGET
+inline void MoveProjectilesSSE2(const ProjectileArrays& a, float delta_time, glm::vec3 camera, float max_distance2){
+    float* pos = (float*)a.pos;
+    float* prev = (float*)a.prev_pos;
+    const float* dir = (const float*)a.direction;
+    __m128 step = _mm_set1_ps(delta_time);
+    __m128 cam0 = _mm_setr_ps(camera.x, camera.y, camera.z, camera.x);
+    __m128 cam1 = _mm_setr_ps(camera.y, camera.z, camera.x, camera.y);
+    __m128 cam2 = _mm_setr_ps(camera.z, camera.x, camera.y, camera.z);
+    __m128 max2 = _mm_set1_ps(max_distance2);
+    size_t i = 0;
+    for (; i + 4 <= a.count; i += 4) {
+        float* p = pos + i * 3;
+        __m128 s = _mm_mul_ps(_mm_loadu_ps(a.speed + i), step);
+        __m128 p0 = _mm_loadu_ps(p);
+        __m128 p1 = _mm_loadu_ps(p + 4);
+        __m128 p2 = _mm_loadu_ps(p + 8);
+        _mm_storeu_ps(prev + i * 3, p0);
+        _mm_storeu_ps(prev + i * 3 + 4, p1);
+        _mm_storeu_ps(prev + i * 3 + 8, p2);
+        // s0 s0 s0 s1 | s1 s1 s2 s2 | s2 s3 s3 s3
+        p0 = _mm_add_ps(p0, _mm_mul_ps(_mm_loadu_ps(dir + i * 3), _mm_shuffle_ps(s, s, _MM_SHUFFLE(1, 0, 0, 0))));
+        p1 = _mm_add_ps(p1, _mm_mul_ps(_mm_loadu_ps(dir + i * 3 + 4), _mm_shuffle_ps(s, s, _MM_SHUFFLE(2, 2, 1, 1))));
+        p2 = _mm_add_ps(p2, _mm_mul_ps(_mm_loadu_ps(dir + i * 3 + 8), _mm_shuffle_ps(s, s, _MM_SHUFFLE(3, 3, 3, 2))));
+        _mm_storeu_ps(p, p0);
+        _mm_storeu_ps(p + 4, p1);
+        _mm_storeu_ps(p + 8, p2);
+
+        __m128 q0 = _mm_sub_ps(p0, cam0);
+        __m128 q1 = _mm_sub_ps(p1, cam1);
+        __m128 q2 = _mm_sub_ps(p2, cam2);
+        q0 = _mm_mul_ps(q0, q0);
+        q1 = _mm_mul_ps(q1, q1);
+        q2 = _mm_mul_ps(q2, q2);
+        // back to one register per axis
+        __m128 t = _mm_shuffle_ps(q1, q2, _MM_SHUFFLE(0, 1, 0, 2));
+        __m128 x = _mm_shuffle_ps(q0, t, _MM_SHUFFLE(2, 0, 3, 0));
+        __m128 u = _mm_shuffle_ps(q0, q1, _MM_SHUFFLE(0, 0, 0, 1));
+        __m128 w = _mm_shuffle_ps(q1, q2, _MM_SHUFFLE(0, 2, 0, 3));
+        __m128 y = _mm_shuffle_ps(u, w, _MM_SHUFFLE(2, 0, 2, 0));
+        u = _mm_shuffle_ps(q0, q1, _MM_SHUFFLE(0, 1, 0, 2));
+        w = _mm_shuffle_ps(q2, q2, _MM_SHUFFLE(0, 3, 0, 0));
+        __m128 z = _mm_shuffle_ps(u, w, _MM_SHUFFLE(2, 0, 2, 0));
+        int mask = _mm_movemask_ps(_mm_cmpge_ps(_mm_add_ps(_mm_add_ps(x, y), z), max2));
+        for (int j = 0; j < 4; ++j) {
+            a.out_of_range[i + j] = (mask >> j) & 1;
+        }
+    }
+    MoveProjectileRange(a, i, delta_time, camera, max_distance2);
+}
+
+// 8 projectiles are 3 registers, speeds are spread over them with
+// permutes and the distances are gathered from the stored positions.
+PROJECTILE_AVX2_TARGET
+inline void MoveProjectilesAVX2(const ProjectileArrays& a, float delta_time, glm::vec3 camera, float max_distance2){
+    float* pos = (float*)a.pos;
+    float* prev = (float*)a.prev_pos;
+    const float* dir = (const float*)a.direction;
+    __m256 step = _mm256_set1_ps(delta_time);
+    __m256i spread0 = _mm256_setr_epi32(0, 0, 0, 1, 1, 1, 2, 2);
+    __m256i spread1 = _mm256_setr_epi32(2, 3, 3, 3, 4, 4, 4, 5);
+    __m256i spread2 = _mm256_setr_epi32(5, 5, 6, 6, 6, 7, 7, 7);
+    __m256i stride = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+    __m256 cam_x = _mm256_set1_ps(camera.x);
+    __m256 cam_y = _mm256_set1_ps(camera.y);
+    __m256 cam_z = _mm256_set1_ps(camera.z);
+    __m256 max2 = _mm256_set1_ps(max_distance2);
+    size_t i = 0;
+    for (; i + 8 <= a.count; i += 8) {
+        float* p = pos + i * 3;
+        __m256 s = _mm256_mul_ps(_mm256_loadu_ps(a.speed + i), step);
+        __m256 p0 = _mm256_loadu_ps(p);
+        __m256 p1 = _mm256_loadu_ps(p + 8);
+        __m256 p2 = _mm256_loadu_ps(p + 16);
+        _mm256_storeu_ps(prev + i * 3, p0);
+        _mm256_storeu_ps(prev + i * 3 + 8, p1);
+        _mm256_storeu_ps(prev + i * 3 + 16, p2);
+        p0 = _mm256_add_ps(p0, _mm256_mul_ps(_mm256_loadu_ps(dir + i * 3), _mm256_permutevar8x32_ps(s, spread0)));
+        p1 = _mm256_add_ps(p1, _mm256_mul_ps(_mm256_loadu_ps(dir + i * 3 + 8), _mm256_permutevar8x32_ps(s, spread1)));
+        p2 = _mm256_add_ps(p2, _mm256_mul_ps(_mm256_loadu_ps(dir + i * 3 + 16), _mm256_permutevar8x32_ps(s, spread2)));
+        _mm256_storeu_ps(p, p0);
+        _mm256_storeu_ps(p + 8, p1);
+        _mm256_storeu_ps(p + 16, p2);
+
+        __m256 x = _mm256_sub_ps(_mm256_i32gather_ps(p, stride, 4), cam_x);
+        __m256 y = _mm256_sub_ps(_mm256_i32gather_ps(p + 1, stride, 4), cam_y);
+        __m256 z = _mm256_sub_ps(_mm256_i32gather_ps(p + 2, stride, 4), cam_z);
+        __m256 distance2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)), _mm256_mul_ps(z, z));
+        int mask = _mm256_movemask_ps(_mm256_cmp_ps(distance2, max2, _CMP_GE_OQ));
+        for (int j = 0; j < 8; ++j) {
+            a.out_of_range[i + j] = (mask >> j) & 1;
+        }
+    }
+    MoveProjectileRange(a, i, delta_time, camera, max_distance2);
+}
+
+// AVX2 needs the OS to save the ymm registers as well.
+inline bool CpuHasAVX2(){
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return false;
+    }
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 6) != 6) {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+
+inline bool CpuHasSSE2(){
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    return true;
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[3] & (1 << 26)) != 0;
+#else
+    return __builtin_cpu_supports("sse2") != 0;
+#endif
+}
+#endif
+
+// Best kernel for the CPU we run on, checked once at startup. name is set
+// to the kernel's name for the log.
+inline ProjectileKernel SelectProjectileKernel(const char** name){
+#ifdef PROJECTILE_KERNELS_X86
+    if (CpuHasAVX2()) {
+        *name = "AVX2";
+        return MoveProjectilesAVX2;
+    }
+    if (CpuHasSSE2()) {
+        *name = "SSE2";
+        return MoveProjectilesSSE2;
+    }
+#endif
+    *name = "scalar";
+    return MoveProjectilesScalar;
+}
+
+#endif
@@ -0,0 +1,152 @@
+#ifndef STREAM_BUFFER_HPP
+#define STREAM_BUFFER_HPP
+
+#include <GL/glew.h>
+#include <cstdio>
+#include <cstdint>
+
+// Ring buffer for data that is rewritten every frame (instance attributes).
+// The buffer is split into regions, one per frame in flight. A frame writes
+// only its own region and fences it after the draws, so the CPU never waits
+// on a region the GPU is still reading, and the driver never reallocates.
+//
+// With GL_ARB_buffer_storage the whole buffer is mapped once (persistent +
+// coherent). On plain GL 3.3 the region is mapped unsynchronized each frame
+// instead, the fences do the synchronization in both cases. A driver that
+// offers buffer storage but fails the persistent mapping gets the plain
+// path too.
+//
+// Every user reserves a fixed slot of each region before Init, so a slot is
+// always at the same offset of its region and vertex array objects can be
+// built once per region.
+//
+// Per frame: BeginFrame, Write..., Submit (before the draws), EndFrame
+// (after the draws).
+class StreamBuffer {
+public:
+    static const int Regions = 3;
+    static const GLsizeiptr Alignment = 16;
+
+    // Reserves bytes in every region, returns the offset of the slot inside
+    // a region. Only valid before Init.
+    GLintptr Reserve(GLsizeiptr bytes){
+        GLintptr slot = region_size;
+        region_size += (bytes + Alignment - 1) / Alignment * Alignment;
+        return slot;
+    }
+
+    void Init(){
+        persistent = GLEW_ARB_buffer_storage != 0;
+
+        glGenBuffers(1, &buffer_id);
+        glBindBuffer(GL_ARRAY_BUFFER, buffer_id);
+        if (persistent) {
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(GL_ARRAY_BUFFER, region_size * Regions, nullptr, flags);
+            persistent_ptr = (uint8_t*)glMapBufferRange(GL_ARRAY_BUFFER, 0, region_size * Regions, flags);
+            if (persistent_ptr == nullptr) {
+                // the storage is immutable, the plain path needs a new buffer
+                fprintf(stderr, "stream buffer: persistent mapping failed, mapping every frame\n");
+                glDeleteBuffers(1, &buffer_id);
+                glGenBuffers(1, &buffer_id);
+                glBindBuffer(GL_ARRAY_BUFFER, buffer_id);
+                persistent = false;
+            }
+        }
+        if (!persistent) {
+            glBufferData(GL_ARRAY_BUFFER, region_size * Regions, nullptr, GL_STREAM_DRAW);
+        }
+        for (int i = 0; i < Regions; ++i) {
+            fences[i] = nullptr;
+        }
+        region = 0;
+    }
+
+    void Destroy(){
+        for (int i = 0; i < Regions; ++i) {
+            if (fences[i]) {
+                glDeleteSync(fences[i]);
+                fences[i] = nullptr;
+            }
+        }
+        if (persistent_ptr) {
+            // the only place a persistent mapping reports lost contents
+            glBindBuffer(GL_ARRAY_BUFFER, buffer_id);
+            if (glUnmapBuffer(GL_ARRAY_BUFFER) == GL_FALSE) {
+                fprintf(stderr, "stream buffer: contents were lost while mapped\n");
+            }
+            persistent_ptr = nullptr;
+        }
+        glDeleteBuffers(1, &buffer_id);
+        buffer_id = 0;
+    }
+
+    GLuint buffer() const { return buffer_id; }
+    bool is_persistent() const { return persistent; }
+
+    // Region written by the current frame.
+    int region_index() const { return region; }
+
+    // Buffer offset of a slot in the given region.
+    GLintptr Offset(int region_index, GLintptr slot) const {
+        return region_index * region_size + slot;
+    }
+
+    // Waits until the GPU is done with the region of this frame and opens it.
+    void BeginFrame(){
+        if (fences[region]) {
+            GLenum status;
+            do {
+                status = glClientWaitSync(fences[region], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+            } while (status == GL_TIMEOUT_EXPIRED);
+            glDeleteSync(fences[region]);
+            fences[region] = nullptr;
+        }
+        if (persistent) {
+            frame_ptr = persistent_ptr + region * region_size;
+        } else {
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT;
+            glBindBuffer(GL_ARRAY_BUFFER, buffer_id);
+            frame_ptr = (uint8_t*)glMapBufferRange(GL_ARRAY_BUFFER, region * region_size, region_size, flags);
+        }
+    }
+
+    // Where to write a slot in this frame, nullptr if the region couldn't
+    // be mapped.
+    void* Write(GLintptr slot){
+        if (frame_ptr == nullptr) {
+            return nullptr;
+        }
+        return frame_ptr + slot;
+    }
+
+    // All writes of the frame are done, the data may be used by draws now.
+    // False if the driver lost the region while it was mapped (e.g. a mode
+    // switch), the frame's writes are garbage then and mustn't be drawn.
+    bool Submit(){
+        bool kept = true;
+        if (!persistent && frame_ptr) {
+            glBindBuffer(GL_ARRAY_BUFFER, buffer_id);
+            kept = glUnmapBuffer(GL_ARRAY_BUFFER) == GL_TRUE;
+        }
+        frame_ptr = nullptr;
+        return kept;
+    }
+
+    // Call after the last draw reading this frame's data.
+    void EndFrame(){
+        fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        region = (region + 1) % Regions;
+    }
+
+private:
+    GLuint buffer_id = 0;
+    bool persistent = false;
+    uint8_t* persistent_ptr = nullptr;
+    uint8_t* frame_ptr = nullptr;
+    GLsizeiptr region_size = 0;
+    int region = 0;
+    GLsync fences[Regions];
+};
+
+#endif
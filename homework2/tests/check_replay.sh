@@ -0,0 +1,53 @@
+#!/bin/sh
+# Replays the regression input log and compares the state hashes and the
+# kill count with the expected ones, without a renderer and with a
+# stand-in render thread at several frame rates: the outcome may not
+# depend on how often the simulation is drawn.
+# Then the input goes the player's way, through SubmitInput and the
+# simulation's batches at several frame rates (--live-input). Frames of
+# several steps put their shots into the first step of the batch, so the
+# outcome changes with the rate, but the input recorded on the way must
+# replay to the state the live run ended in. Run it from homework2/ with
+# the built game:
+#
+#   tests/check_replay.sh ./homework2
+#
+# regression.log is a two minute synthetic session: the camera circles the
+# origin and fires in about one step in ten, in a random direction.
+# After a change that is meant to alter the simulation, regenerate the
+# expected output with
+#
+#   ./homework2 --replay tests/replay/regression.log --hash-every 600 |
+#       grep -E '^(step |[0-9]+ enemies killed)' > tests/replay/regression.expected
+
+binary=${1:?usage: $0 <homework2 binary>}
+dir=$(dirname "$0")/replay
+expected="$dir/regression.expected"
+
+status=0
+for fps in 0 60 1000 100000; do
+    actual=$("$binary" --replay "$dir/regression.log" --hash-every 600 --render-fps $fps |
+             grep -E '^(step |[0-9]+ enemies killed)')
+    if [ "$actual" != "$(cat "$expected")" ]; then
+        echo "replay of $dir/regression.log at $fps fps differs from $expected:"
+        echo "$actual" | diff "$expected" -
+        status=1
+    else
+        echo "$fps fps: matches, $(tail -n 1 "$expected")"
+    fi
+done
+
+recording=$(mktemp)
+for fps in 144 60 24 7; do
+    live=$("$binary" --replay "$dir/regression.log" --render-fps $fps --live-input --record "$recording" |
+           grep -E '^[0-9]+ enemies killed')
+    replayed=$("$binary" --replay "$recording" | grep -E '^[0-9]+ enemies killed')
+    if [ -z "$live" ] || [ "$live" != "$replayed" ]; then
+        echo "live input at $fps fps ended in \"$live\", its recording replays to \"$replayed\""
+        status=1
+    else
+        echo "$fps fps live input: recording replays the same, $live"
+    fi
+done
+rm -f "$recording"
+exit $status
@@ -0,0 +1,46 @@
+// ParallelCullSpheres against CullSpheres, with and without an index
+// list, for counts of one to many chunks.
+//
+//   g++ -O2 -std=c++11 -pthread -I.. -I<glm> cull_check.cpp -o cull_check
+
+#include "frustum.hpp"
+#include <random>
+#include <cstdio>
+
+int main(){
+    JobSystem jobs;
+    jobs.Start(3);
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> coordinate(-3.0f, 3.0f);
+    // the clip cube of the identity matrix
+    Frustum frustum = Frustum::FromMatrix(glm::mat4(1.0f));
+    const size_t min_chunk = 4096;
+    const size_t counts[] = {1, 4095, 4096, 4097, 3 * 4096 + 5, 100000};
+    int failures = 0;
+    for (size_t count : counts) {
+        std::vector<glm::vec3> positions(count);
+        for (glm::vec3& p : positions) {
+            p = glm::vec3(coordinate(random), coordinate(random), coordinate(random));
+        }
+        std::vector<uint32_t> order(count);
+        for (size_t i = 0; i < count; ++i) {
+            order[i] = (uint32_t)i;
+        }
+        std::shuffle(order.begin(), order.end(), random);
+
+        std::vector<uint32_t> serial(count), parallel(count);
+        std::vector<size_t> chunk_visible;
+        const uint32_t* index_lists[2] = {nullptr, order.data()};
+        for (const uint32_t* indices : index_lists) {
+            size_t n = CullSpheres(frustum, positions.data(), indices, count, 0.5f, serial.data());
+            size_t m = ParallelCullSpheres(jobs, min_chunk, frustum, positions.data(), indices, count, 0.5f,
+                                           parallel.data(), chunk_visible);
+            bool same = n == m && std::equal(serial.begin(), serial.begin() + n, parallel.begin());
+            printf("%6zu spheres, %zu chunks, %s: %zu visible, %s\n", count, chunk_visible.size(),
+                   indices ? "indexed" : "in order", n, same ? "ok" : "MISMATCH");
+            failures += same ? 0 : 1;
+        }
+    }
+    jobs.Stop();
+    return failures == 0 ? 0 : 1;
+}
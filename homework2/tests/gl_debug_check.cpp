@@ -0,0 +1,260 @@
+// PrintGLDebugMessage in a real debug context without a window
+// (egl_context.hpp). A GL error and a high severity message are printed
+// before the call that raised them returns, a notification isn't printed.
+// Then the enemy and projectile instance streams are filled to capacity
+// through InstanceUpload and StreamBuffer and drawn with homework2's
+// shaders, on the persistent and the plain GL 3.3 path, for twice around
+// the ring: nothing may be printed and glGetError must stay clear. stderr
+// goes to a file that is read back. Run from tests/, the shaders are read
+// from the directory above.
+//
+//   g++ -std=c++11 -pthread -I.. -I<glm> -I<glew> gl_debug_check.cpp -o gl_debug_check -lGLEW -lEGL -lGL
+
+#include "egl_context.hpp"
+#include "gl_debug.hpp"
+#include "instance_upload.hpp"
+#include <string>
+#include <cstddef>
+#include <cstring>
+
+using glm::vec2;
+using glm::vec3;
+using glm::vec4;
+
+const char* const CapturePath = "gl_debug_check.txt";
+
+// homework2's capacities and instance records
+const int MaxEnemies = 20;
+const int MaxProjectiles = 50;
+const int ProjectileLodCount = 4;
+
+struct EnemyInstance {
+    vec4 quaternion; // location 1
+    vec3 position;   // location 2
+};
+
+struct EnemyVertex {
+    vec3 position; // location 0
+    vec3 color;    // location 3
+};
+
+struct ProjectileVertex {
+    vec3 position; // location 0
+    vec2 uv;       // location 2
+};
+
+// The whole file, empty if it can't be read.
+std::string ReadFile(const char* path){
+    std::string text;
+    FILE* f = fopen(path, "rb");
+    if (f != nullptr) {
+        char chunk[256];
+        size_t read;
+        while ((read = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+            text.append(chunk, read);
+        }
+        fclose(f);
+    }
+    return text;
+}
+
+// What the callback has printed so far.
+std::string Captured(){
+    fflush(stderr);
+    return ReadFile(CapturePath);
+}
+
+GLuint LoadProgram(const char* vertex_path, const char* fragment_path){
+    std::string vertex_code = ReadFile(vertex_path);
+    std::string fragment_code = ReadFile(fragment_path);
+    if (vertex_code.empty() || fragment_code.empty()) {
+        printf("can't read %s or %s\n", vertex_path, fragment_path);
+        return 0;
+    }
+    return CompileProgram(vertex_code.c_str(), fragment_code.c_str());
+}
+
+// Per-vertex attributes of a static mesh in the bound VAO.
+template <typename Vertex>
+void SetMeshPointers(GLuint vertex_buffer, GLuint index_buffer, GLuint second_location, size_t second_offset,
+                     GLint second_components){
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+    glEnableVertexAttribArray(second_location);
+    glVertexAttribPointer(second_location, second_components, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)second_offset);
+}
+
+// 2 * Regions frames with every instance slot full, false if a slot
+// couldn't be written.
+bool DrawAtCapacity(GLuint enemy_program, GLuint projectile_program){
+    const EnemyVertex enemy_vertices[3] = {
+        {vec3(0.0f, 1.0f, 0.0f), vec3(1.0f, 0.0f, 0.0f)},
+        {vec3(-1.0f, 0.0f, -1.0f), vec3(0.0f, 1.0f, 0.0f)},
+        {vec3(1.0f, 0.0f, 1.0f), vec3(0.0f, 0.0f, 1.0f)},
+    };
+    const ProjectileVertex projectile_vertices[3] = {
+        {vec3(-0.25f, 0.0f, 0.0f), vec2(0.0f, 0.0f)},
+        {vec3(0.25f, 0.0f, 0.0f), vec2(1.0f, 0.0f)},
+        {vec3(0.0f, 0.25f, 0.0f), vec2(0.5f, 1.0f)},
+    };
+    const uint32_t indices[3] = {0, 1, 2};
+    GLuint buffers[4];
+    glGenBuffers(4, buffers);
+    glBindBuffer(GL_ARRAY_BUFFER, buffers[0]);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(enemy_vertices), enemy_vertices, GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, buffers[1]);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(projectile_vertices), projectile_vertices, GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, buffers[2]);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+
+    StreamBuffer stream;
+    InstanceUpload<EnemyInstance> enemy_instances;
+    enemy_instances.Init("enemy instances", MaxEnemies, stream);
+    enemy_instances.AddAttribute<vec4>(1, offsetof(EnemyInstance, quaternion));
+    enemy_instances.AddAttribute<vec3>(2, offsetof(EnemyInstance, position));
+    InstanceUpload<vec3> projectile_instances[ProjectileLodCount];
+    for (int lod = 0; lod < ProjectileLodCount; ++lod) {
+        projectile_instances[lod].Init("projectile instances", MaxProjectiles, stream);
+        projectile_instances[lod].AddAttribute<vec3>(1, 0);
+    }
+    stream.Init();
+
+    GLuint enemy_vao[StreamBuffer::Regions], projectile_vao[ProjectileLodCount][StreamBuffer::Regions];
+    glGenVertexArrays(StreamBuffer::Regions, enemy_vao);
+    glGenVertexArrays(ProjectileLodCount * StreamBuffer::Regions, projectile_vao[0]);
+    for (int region = 0; region < StreamBuffer::Regions; ++region) {
+        glBindVertexArray(enemy_vao[region]);
+        SetMeshPointers<EnemyVertex>(buffers[0], buffers[2], 3, offsetof(EnemyVertex, color), 3);
+        glBindBuffer(GL_ARRAY_BUFFER, stream.buffer());
+        enemy_instances.SetPointers(stream, region);
+        for (int lod = 0; lod < ProjectileLodCount; ++lod) {
+            glBindVertexArray(projectile_vao[lod][region]);
+            SetMeshPointers<ProjectileVertex>(buffers[1], buffers[2], 2, offsetof(ProjectileVertex, uv), 2);
+            glBindBuffer(GL_ARRAY_BUFFER, stream.buffer());
+            projectile_instances[lod].SetPointers(stream, region);
+        }
+    }
+    glBindVertexArray(0);
+
+    // there is no default framebuffer, the draws need a complete one
+    GLuint framebuffer;
+    glGenRenderbuffers(1, &buffers[3]);
+    glBindRenderbuffer(GL_RENDERBUFFER, buffers[3]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, 64, 64);
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, buffers[3]);
+    glViewport(0, 0, 64, 64);
+
+    glm::mat4 mvp(1.0f);
+    bool written = true;
+    for (int frame = 0; frame < 2 * StreamBuffer::Regions; ++frame) {
+        stream.BeginFrame();
+        if (EnemyInstance* records = enemy_instances.Begin(stream, MaxEnemies)) {
+            for (int i = 0; i < MaxEnemies; ++i) {
+                records[i].quaternion = vec4(0.0f, 0.0f, 0.0f, 1.0f);
+                records[i].position = vec3(i * 0.05f - 0.5f, 0.0f, 0.0f);
+            }
+        } else {
+            written = false;
+        }
+        for (int lod = 0; lod < ProjectileLodCount; ++lod) {
+            if (vec3* records = projectile_instances[lod].Begin(stream, MaxProjectiles)) {
+                for (int i = 0; i < MaxProjectiles; ++i) {
+                    records[i] = vec3(i * 0.02f - 0.5f, lod * 0.2f - 0.4f, 0.0f);
+                }
+            } else {
+                written = false;
+            }
+        }
+        written = stream.Submit() && written;
+        glClear(GL_COLOR_BUFFER_BIT);
+        int region = stream.region_index();
+        glUseProgram(enemy_program);
+        glUniformMatrix4fv(glGetUniformLocation(enemy_program, "MVP"), 1, GL_FALSE, &mvp[0][0]);
+        glBindVertexArray(enemy_vao[region]);
+        glDrawElementsInstanced(GL_TRIANGLES, 3, GL_UNSIGNED_INT, (void*)0, (GLsizei)enemy_instances.count());
+        glUseProgram(projectile_program);
+        glUniformMatrix4fv(glGetUniformLocation(projectile_program, "MVP"), 1, GL_FALSE, &mvp[0][0]);
+        for (int lod = 0; lod < ProjectileLodCount; ++lod) {
+            glBindVertexArray(projectile_vao[lod][region]);
+            glDrawElementsInstanced(GL_TRIANGLES, 3, GL_UNSIGNED_INT, (void*)0,
+                                    (GLsizei)projectile_instances[lod].count());
+        }
+        stream.EndFrame();
+    }
+    glFinish();
+
+    glBindVertexArray(0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteRenderbuffers(1, &buffers[3]);
+    glDeleteVertexArrays(StreamBuffer::Regions, enemy_vao);
+    glDeleteVertexArrays(ProjectileLodCount * StreamBuffer::Regions, projectile_vao[0]);
+    glDeleteBuffers(3, buffers);
+    stream.Destroy();
+    return written;
+}
+
+int main(){
+    if (!CreateHeadlessContext(true)) {
+        printf("no surfaceless GL 3.3 debug context\n");
+        return 1;
+    }
+    printf("%s, %s\n", (const char*)glGetString(GL_RENDERER), (const char*)glGetString(GL_VERSION));
+
+    if (freopen(CapturePath, "w", stderr) == nullptr) {
+        printf("can't write %s\n", CapturePath);
+        return 1;
+    }
+    EnableGLDebugOutput();
+    int failures = 0;
+
+    glEnable(0x1234);
+    std::string text = Captured();
+    bool printed = text.find("GL error: ") == 0 && text.find('\n') == text.size() - 1;
+    printf("invalid enum: %s", printed ? text.c_str() : "NOT PRINTED\n");
+    failures += printed && glGetError() == GL_INVALID_ENUM ? 0 : 1;
+
+    size_t before = text.size();
+    glDebugMessageInsert(GL_DEBUG_SOURCE_APPLICATION, GL_DEBUG_TYPE_MARKER, 1, GL_DEBUG_SEVERITY_NOTIFICATION, -1,
+                         "frame start");
+    bool quiet = Captured().size() == before;
+    printf("notification: %s\n", quiet ? "not printed" : "PRINTED");
+    failures += quiet ? 0 : 1;
+
+    glDebugMessageInsert(GL_DEBUG_SOURCE_APPLICATION, GL_DEBUG_TYPE_OTHER, 2, GL_DEBUG_SEVERITY_HIGH, -1,
+                         "out of instance space");
+    printed = Captured().substr(before) == "GL error: out of instance space\n";
+    printf("high severity: %s\n", printed ? "printed" : "NOT PRINTED");
+    failures += printed ? 0 : 1;
+
+    GLuint enemy_program = LoadProgram("../Enemy.vertexshader", "../Enemy.fragmentshader");
+    GLuint projectile_program = LoadProgram("../Projectile.vertexshader", "../Projectile.fragmentshader");
+    failures += enemy_program != 0 && projectile_program != 0 ? 0 : 1;
+    bool has_buffer_storage = GLEW_ARB_buffer_storage != 0;
+    for (int path = 0; path < 2 && enemy_program != 0 && projectile_program != 0; ++path) {
+        // what GLEW_ARB_buffer_storage reads, the plain path the second time
+        __GLEW_ARB_buffer_storage = path == 0 ? has_buffer_storage : GL_FALSE;
+        GetAsyncLogger().Start();
+        before = Captured().size();
+        bool written = DrawAtCapacity(enemy_program, projectile_program);
+        GetAsyncLogger().Stop();
+        GLenum error = glGetError();
+        std::string printed_text = Captured().substr(before);
+        bool clean = written && error == GL_NO_ERROR && printed_text.empty();
+        printf("%s streams at capacity: %s", path == 0 && has_buffer_storage ? "persistent" : "GL 3.3",
+               clean ? "clean\n" : "");
+        if (!clean) {
+            printf("%s, GL error 0x%x\n%s", written ? "written" : "NOT WRITTEN", error, printed_text.c_str());
+        }
+        failures += clean ? 0 : 1;
+    }
+    glDeleteProgram(enemy_program);
+    glDeleteProgram(projectile_program);
+
+    remove(CapturePath);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,111 @@
+// LoadOBJParallel gives the same bytes as the scanf based loader, on one
+// thread and on several, and obj::ParseFloat's fast path is exact: every
+// token it takes parses to the same float as strtof. All the six decimal
+// values it takes are tried, then random ones of every power of ten.
+//
+//   g++ -O2 -std=c++11 -pthread -I.. -I<glm> obj_loader_check.cpp -o obj_loader_check
+
+#include "obj_loader.hpp"
+#include "obj_reference.hpp"
+#include <random>
+#include <string>
+
+// Both parses of token, false if they differ.
+bool SameAsStrtof(const char* token){
+    const char* p = token;
+    float fast;
+    if (!obj::ParseFloat(p, token + strlen(token), fast)) {
+        printf("  %s: not parsed\n", token);
+        return false;
+    }
+    float reference = strtof(token, nullptr);
+    if (memcmp(&fast, &reference, sizeof(float)) != 0) {
+        printf("  %s: %.9g, strtof %.9g\n", token, fast, reference);
+        return false;
+    }
+    return true;
+}
+
+// mantissa * 10^exponent written out without an exponent, as "%.6f" does.
+void FormatDecimal(bool negative, uint32_t mantissa, int exponent, char* out){
+    char digits[32];
+    int length = snprintf(digits, sizeof(digits), "%u", mantissa);
+    std::string text(negative ? "-" : "");
+    if (exponent >= 0) {
+        text += digits;
+        text.append(exponent, '0');
+    } else if (length > -exponent) {
+        text.append(digits, length + exponent);
+        text += ".";
+        text.append(digits + length + exponent);
+    } else {
+        text += "0.";
+        text.append(-exponent - length, '0');
+        text += digits;
+    }
+    strcpy(out, text.c_str());
+}
+
+int CheckParseFloat(){
+    int failures = 0;
+    char token[64];
+    const uint32_t MaxMantissa = 1u << 24;
+    for (uint32_t m = 0; m <= MaxMantissa && failures < 10; ++m) {
+        FormatDecimal(false, m, -6, token);
+        failures += SameAsStrtof(token) ? 0 : 1;
+    }
+    printf("every 0.000000 to %.6f: %s\n", MaxMantissa * 1e-6, failures == 0 ? "same as strtof" : "DIFFERENT");
+
+    std::mt19937 random(7);
+    std::uniform_int_distribution<uint32_t> mantissa(0, MaxMantissa);
+    int sample_failures = 0;
+    for (int exponent = -10; exponent <= 10; ++exponent) {
+        for (int i = 0; i < 100000 && sample_failures < 10; ++i) {
+            uint32_t m = i < 2 ? i * MaxMantissa : mantissa(random);
+            bool negative = (i & 4) != 0;
+            FormatDecimal(negative, m, exponent, token);
+            sample_failures += SameAsStrtof(token) ? 0 : 1;
+            // the same value with an exponent, "123e-4"
+            snprintf(token, sizeof(token), "%s%ue%d", negative ? "-" : "", m, exponent);
+            sample_failures += SameAsStrtof(token) ? 0 : 1;
+        }
+    }
+    printf("random mantissas, 1e-10 to 1e10: %s\n", sample_failures == 0 ? "same as strtof" : "DIFFERENT");
+    return failures + sample_failures;
+}
+
+int main(){
+    int failures = CheckParseFloat();
+
+    const char* path = "obj_loader_check.obj";
+    if (!WriteSphereOBJ(path, 200, 400)) {
+        printf("can't write %s\n", path);
+        return 1;
+    }
+    std::vector<glm::vec3> reference_vertices, reference_normals;
+    std::vector<glm::vec2> reference_uvs;
+    if (!ScanfLoadOBJ(path, reference_vertices, reference_uvs, reference_normals)) {
+        printf("scanf loader failed\n");
+        return 1;
+    }
+    GetAsyncLogger().Start();
+    const int worker_counts[] = {0, 1, 3};
+    for (int workers : worker_counts) {
+        JobSystem jobs;
+        jobs.Start(workers);
+        std::vector<glm::vec3> vertices, normals;
+        std::vector<glm::vec2> uvs;
+        bool loaded = LoadOBJParallel(jobs, path, vertices, uvs, normals);
+        jobs.Stop();
+        size_t n = reference_vertices.size();
+        bool same = loaded && vertices.size() == n && uvs.size() == n && normals.size() == n &&
+                    memcmp(vertices.data(), reference_vertices.data(), n * sizeof(glm::vec3)) == 0 &&
+                    memcmp(uvs.data(), reference_uvs.data(), n * sizeof(glm::vec2)) == 0 &&
+                    memcmp(normals.data(), reference_normals.data(), n * sizeof(glm::vec3)) == 0;
+        printf("%d workers: %zu vertices, %s\n", workers, vertices.size(), same ? "same bytes" : "DIFFERENT");
+        failures += same ? 0 : 1;
+    }
+    GetAsyncLogger().Stop();
+    remove(path);
+    return failures == 0 ? 0 : 1;
+}
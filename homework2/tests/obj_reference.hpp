@@ -0,0 +1,100 @@
+#ifndef OBJ_REFERENCE_HPP
+#define OBJ_REFERENCE_HPP
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+// What the OBJ loader is checked and timed against: common/objloader's
+// loadOBJ, the scanf based loader LoadOBJParallel replaces, and a sphere
+// written the way Blender exports one.
+
+inline bool ScanfLoadOBJ(const char* path, std::vector<glm::vec3>& out_vertices,
+                         std::vector<glm::vec2>& out_uvs, std::vector<glm::vec3>& out_normals){
+    std::vector<unsigned int> vertex_indices, uv_indices, normal_indices;
+    std::vector<glm::vec3> temp_vertices;
+    std::vector<glm::vec2> temp_uvs;
+    std::vector<glm::vec3> temp_normals;
+    FILE* file = fopen(path, "r");
+    if (file == nullptr) {
+        return false;
+    }
+    for (;;) {
+        char line_header[128];
+        if (fscanf(file, "%127s", line_header) == EOF) {
+            break;
+        }
+        if (strcmp(line_header, "v") == 0) {
+            glm::vec3 vertex;
+            fscanf(file, "%f %f %f\n", &vertex.x, &vertex.y, &vertex.z);
+            temp_vertices.push_back(vertex);
+        } else if (strcmp(line_header, "vt") == 0) {
+            glm::vec2 uv;
+            fscanf(file, "%f %f\n", &uv.x, &uv.y);
+            uv.y = -uv.y;
+            temp_uvs.push_back(uv);
+        } else if (strcmp(line_header, "vn") == 0) {
+            glm::vec3 normal;
+            fscanf(file, "%f %f %f\n", &normal.x, &normal.y, &normal.z);
+            temp_normals.push_back(normal);
+        } else if (strcmp(line_header, "f") == 0) {
+            unsigned int v[3], t[3], n[3];
+            int matches = fscanf(file, "%u/%u/%u %u/%u/%u %u/%u/%u\n",
+                                 &v[0], &t[0], &n[0], &v[1], &t[1], &n[1], &v[2], &t[2], &n[2]);
+            if (matches != 9) {
+                fclose(file);
+                return false;
+            }
+            for (int k = 0; k < 3; ++k) {
+                vertex_indices.push_back(v[k]);
+                uv_indices.push_back(t[k]);
+                normal_indices.push_back(n[k]);
+            }
+        } else {
+            char rest[1000];
+            fgets(rest, sizeof(rest), file);
+        }
+    }
+    fclose(file);
+    for (size_t i = 0; i < vertex_indices.size(); ++i) {
+        out_vertices.push_back(temp_vertices[vertex_indices[i] - 1]);
+        out_uvs.push_back(temp_uvs[uv_indices[i] - 1]);
+        out_normals.push_back(temp_normals[normal_indices[i] - 1]);
+    }
+    return true;
+}
+
+// A UV sphere of rings * segments quads, split in triangles. Positions
+// and uvs are "%.6f" like Blender's; the normals are "%.9g", which gives
+// exponents and long mantissas, the parser's strtof path.
+inline bool WriteSphereOBJ(const char* path, int rings, int segments){
+    FILE* f = fopen(path, "w");
+    if (f == nullptr) {
+        return false;
+    }
+    fprintf(f, "# sphere, %d rings, %d segments\nmtllib sphere.mtl\no Sphere\n", rings, segments);
+    for (int r = 0; r <= rings; ++r) {
+        for (int s = 0; s <= segments; ++s) {
+            double theta = 3.14159265358979 * r / rings;
+            double phi = 2.0 * 3.14159265358979 * s / segments;
+            double x = sin(theta) * cos(phi), y = cos(theta), z = sin(theta) * sin(phi);
+            fprintf(f, "v %.6f %.6f %.6f\n", x, y, z);
+            fprintf(f, "vt %.6f %.6f\n", (double)s / segments, (double)r / rings);
+            fprintf(f, "vn %.9g %.9g %.9g\n", x, y, z);
+        }
+    }
+    fprintf(f, "usemtl Material\ns off\n");
+    for (int r = 0; r < rings; ++r) {
+        for (int s = 0; s < segments; ++s) {
+            int a = r * (segments + 1) + s + 1;
+            int b = a + segments + 1;
+            fprintf(f, "f %d/%d/%d %d/%d/%d %d/%d/%d\n", a, a, a, b, b, b, a + 1, a + 1, a + 1);
+            fprintf(f, "f %d/%d/%d %d/%d/%d %d/%d/%d\n", a + 1, a + 1, a + 1, b, b, b, b + 1, b + 1, b + 1);
+        }
+    }
+    return fclose(f) == 0;
+}
+
+#endif
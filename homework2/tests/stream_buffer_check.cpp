@@ -0,0 +1,113 @@
+// StreamBuffer in a real GL context without a window (egl_context.hpp),
+// on the persistent path and on the plain GL 3.3 path. Every frame writes
+// its own pattern into two slots and copies its region into a buffer of
+// its own on the GPU before EndFrame, for four times around the ring. The
+// copies are read back at the end: each must hold its frame's pattern, so
+// no frame overwrote a region the GPU was still reading after the fence
+// wrapped around, and the frames must have walked the regions in order.
+//
+//   g++ -std=c++11 -I.. -I<glew> stream_buffer_check.cpp -o stream_buffer_check -lGLEW -lEGL -lGL
+
+#include "egl_context.hpp"
+#include "stream_buffer.hpp"
+#include <vector>
+#include <cstdint>
+
+const int Frames = 4 * StreamBuffer::Regions;
+const size_t Counts[2] = {100000, 37}; // the second slot doesn't end aligned
+
+uint32_t Pattern(int frame, int slot, size_t i){
+    return (uint32_t)(frame * 2654435761u) ^ (uint32_t)(slot << 28) ^ (uint32_t)i;
+}
+
+// The frames of one path, the number of failures.
+int RunFrames(){
+    StreamBuffer stream;
+    GLintptr slots[2];
+    for (int s = 0; s < 2; ++s) {
+        slots[s] = stream.Reserve(Counts[s] * sizeof(uint32_t));
+    }
+    stream.Init();
+    printf("%s path\n", stream.is_persistent() ? "persistent" : "GL 3.3");
+    int failures = 0;
+    if (slots[1] % StreamBuffer::Alignment != 0) {
+        printf("  slot 1 at %ld: NOT ALIGNED\n", (long)slots[1]);
+        ++failures;
+    }
+    GLsizeiptr region_bytes = stream.Offset(1, 0);
+    std::vector<GLuint> copies(Frames);
+    std::vector<int> regions(Frames);
+    glGenBuffers(Frames, copies.data());
+    for (int frame = 0; frame < Frames; ++frame) {
+        stream.BeginFrame();
+        regions[frame] = stream.region_index();
+        for (int s = 0; s < 2; ++s) {
+            uint32_t* values = (uint32_t*)stream.Write(slots[s]);
+            if (values == nullptr) {
+                printf("  frame %d: region not mapped\n", frame);
+                return failures + 1;
+            }
+            for (size_t i = 0; i < Counts[s]; ++i) {
+                values[i] = Pattern(frame, s, i);
+            }
+        }
+        if (!stream.Submit()) {
+            printf("  frame %d: region lost\n", frame);
+            ++failures;
+        }
+        // stands in for the draws reading the region
+        glBindBuffer(GL_COPY_READ_BUFFER, stream.buffer());
+        glBindBuffer(GL_COPY_WRITE_BUFFER, copies[frame]);
+        glBufferData(GL_COPY_WRITE_BUFFER, region_bytes, nullptr, GL_STATIC_READ);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, stream.Offset(regions[frame], 0), 0, region_bytes);
+        stream.EndFrame();
+    }
+
+    std::vector<uint32_t> region(region_bytes / sizeof(uint32_t));
+    for (int frame = 0; frame < Frames; ++frame) {
+        if (regions[frame] != frame % StreamBuffer::Regions) {
+            printf("  frame %d: region %d, expected %d\n", frame, regions[frame], frame % StreamBuffer::Regions);
+            ++failures;
+        }
+        glBindBuffer(GL_COPY_READ_BUFFER, copies[frame]);
+        glGetBufferSubData(GL_COPY_READ_BUFFER, 0, region_bytes, region.data());
+        size_t wrong = 0;
+        for (int s = 0; s < 2; ++s) {
+            const uint32_t* values = region.data() + slots[s] / sizeof(uint32_t);
+            for (size_t i = 0; i < Counts[s]; ++i) {
+                wrong += values[i] != Pattern(frame, s, i) ? 1 : 0;
+            }
+        }
+        if (wrong != 0) {
+            printf("  frame %d: %zu values overwritten\n", frame, wrong);
+            ++failures;
+        }
+    }
+    glDeleteBuffers(Frames, copies.data());
+    stream.Destroy();
+    GLenum error = glGetError();
+    if (error != GL_NO_ERROR) {
+        printf("  GL error 0x%x\n", error);
+        ++failures;
+    }
+    printf("  %d frames over %d regions: %s\n", Frames, StreamBuffer::Regions, failures == 0 ? "ok" : "FAILED");
+    return failures;
+}
+
+int main(){
+    if (!CreateHeadlessContext(false)) {
+        printf("no surfaceless GL 3.3 context\n");
+        return 1;
+    }
+    printf("%s, %s\n", (const char*)glGetString(GL_RENDERER), (const char*)glGetString(GL_VERSION));
+    int failures = 0;
+    if (GLEW_ARB_buffer_storage) {
+        failures += RunFrames();
+    } else {
+        printf("no GL_ARB_buffer_storage, persistent path not checked\n");
+    }
+    // what GLEW_ARB_buffer_storage reads, the plain path from here on
+    __GLEW_ARB_buffer_storage = GL_FALSE;
+    failures += RunFrames();
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,248 @@
+// TextureStreamer in a real GL context without a window (egl_context.hpp)
+// with synthetic DXT1 files of a full mip chain, written here and read
+// back with ReadDDS. Checked on the GL textures themselves: a texture
+// starts with its smallest level, one Update uploads no more than the
+// upload budget (a single larger level alone), the levels come in finest
+// last until all are resident, and the resident bytes never go over the
+// memory budget. Past it the least recently used texture drops its top
+// level, textures used in the same frame don't evict each other, and the
+// dropped texture keeps the right data from its new base level on.
+//
+//   g++ -std=c++11 -pthread -I.. -I<glew> texture_streamer_check.cpp -o texture_streamer_check -lGLEW -lEGL -lGL
+
+#include "egl_context.hpp"
+#include "texture_streamer.hpp"
+#include <string>
+
+const uint32_t Size = 256;
+const uint32_t MipCount = 9; // 256 down to 1
+const int TextureCount = 3;
+
+// The level data of texture n, every byte different from its neighbours'.
+std::vector<uint8_t> MakeLevels(int n){
+    size_t total = 0;
+    for (uint32_t level = 0; level < MipCount; ++level) {
+        uint32_t size = std::max(Size >> level, 1u);
+        total += DDSLevelSize(GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, size, size);
+    }
+    std::vector<uint8_t> data(total);
+    for (size_t i = 0; i < total; ++i) {
+        data[i] = (uint8_t)(i * 7 + n * 101 + (i >> 8));
+    }
+    return data;
+}
+
+bool WriteDDS(const char* path, const std::vector<uint8_t>& levels){
+    uint8_t header[124] = {};
+    uint32_t fields[][2] = {
+        {0, 124}, {4, 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000}, {8, Size}, {12, Size}, {24, MipCount},
+        {72, 32}, {76, 0x4}, // pixel format: size, DDPF_FOURCC
+    };
+    for (const auto& field : fields) {
+        memcpy(header + field[0], &field[1], 4);
+    }
+    memcpy(header + 80, "DXT1", 4);
+    FILE* f = fopen(path, "wb");
+    if (f == nullptr) {
+        return false;
+    }
+    bool written = fwrite("DDS ", 1, 4, f) == 4 && fwrite(header, 1, sizeof(header), f) == sizeof(header) &&
+                   fwrite(levels.data(), 1, levels.size(), f) == levels.size();
+    return fclose(f) == 0 && written;
+}
+
+GLint BaseLevel(GLuint id){
+    GLint base = -1;
+    glBindTexture(GL_TEXTURE_2D, id);
+    glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, &base);
+    return base;
+}
+
+// Bytes of all levels the GL texture holds.
+size_t TextureBytes(GLuint id){
+    size_t bytes = 0;
+    glBindTexture(GL_TEXTURE_2D, id);
+    for (GLint level = 0; level < (GLint)MipCount; ++level) {
+        GLint size = 0, compressed = GL_FALSE;
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_COMPRESSED, &compressed);
+        if (compressed) {
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &size);
+        }
+        bytes += size;
+    }
+    return bytes;
+}
+
+// The texture holds the file's data from its base level on and nothing
+// above it.
+bool SameLevels(GLuint id, const std::vector<uint8_t>& levels){
+    DDSImage image;
+    image.format = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+    image.width = image.height = Size;
+    image.mip_count = MipCount;
+    GLint base = BaseLevel(id);
+    std::vector<uint8_t> level_data;
+    for (GLint level = 0; level < (GLint)MipCount; ++level) {
+        GLint size = 0, compressed = GL_FALSE;
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_COMPRESSED, &compressed);
+        if (compressed) {
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &size);
+        }
+        if (level < base) {
+            if (size != 0) {
+                return false;
+            }
+            continue;
+        }
+        size_t offset = DDSLevelOffset(image, level);
+        if ((size_t)size != DDSLevelOffset(image, level + 1) - offset) {
+            return false;
+        }
+        level_data.resize(size);
+        glGetCompressedTexImage(GL_TEXTURE_2D, level, level_data.data());
+        if (memcmp(level_data.data(), levels.data() + offset, size) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+struct Check {
+    int failures = 0;
+
+    void operator()(bool ok, const char* what){
+        printf("%s: %s\n", what, ok ? "ok" : "FAILED");
+        failures += ok ? 0 : 1;
+    }
+};
+
+int main(){
+    if (!CreateHeadlessContext(false)) {
+        printf("no surfaceless GL 3.3 context\n");
+        return 1;
+    }
+    printf("%s, %s\n", (const char*)glGetString(GL_RENDERER), (const char*)glGetString(GL_VERSION));
+    GetAsyncLogger().Start();
+    Check check;
+
+    std::vector<uint8_t> levels[TextureCount];
+    DDSImage images[TextureCount];
+    std::string paths[TextureCount];
+    bool read = true;
+    for (int n = 0; n < TextureCount; ++n) {
+        levels[n] = MakeLevels(n);
+        paths[n] = "texture_streamer_check_" + std::to_string(n) + ".dds";
+        read = read && WriteDDS(paths[n].c_str(), levels[n]) && ReadDDS(paths[n].c_str(), images[n]) &&
+               images[n].format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT && images[n].width == Size &&
+               images[n].height == Size && images[n].mip_count == MipCount && images[n].data == levels[n];
+        remove(paths[n].c_str());
+    }
+    check(read, "ReadDDS reads the mip chain written");
+    if (!read) {
+        GetAsyncLogger().Stop();
+        return 1;
+    }
+    const size_t texture_bytes = levels[0].size();
+    const size_t top_level_bytes = DDSLevelSize(GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, Size, Size);
+    const size_t smallest_bytes = DDSLevelSize(GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, 1, 1);
+
+    // room for two textures and all but the top level of a third
+    const size_t upload_budget = 4096;
+    const size_t memory_budget = 3 * texture_bytes - top_level_bytes + 4096;
+    TextureStreamer streamer;
+    streamer.Init(upload_budget, memory_budget);
+    int textures[TextureCount];
+    textures[0] = streamer.Add(images[0]);
+    check(BaseLevel(streamer.id(textures[0])) == (GLint)MipCount - 1 &&
+          TextureBytes(streamer.id(textures[0])) == smallest_bytes && streamer.resident_bytes() == smallest_bytes &&
+          streamer.pending_uploads() == MipCount - 1 && streamer.pending_bytes() == texture_bytes - smallest_bytes,
+          "Add makes the smallest level resident");
+
+    // resident bytes match GL, stay in the budget and grow by at most the
+    // upload budget or one level per Update
+    bool in_budget = true;
+    auto update = [&]() {
+        size_t before = streamer.resident_bytes();
+        streamer.Update();
+        size_t gl_bytes = 0;
+        for (int n = 0; n < TextureCount; ++n) {
+            gl_bytes += textures[n] >= 0 ? TextureBytes(streamer.id(textures[n])) : 0;
+        }
+        size_t after = streamer.resident_bytes();
+        in_budget = in_budget && after == gl_bytes && after <= memory_budget &&
+                    (after <= before || after - before <= std::max(upload_budget, top_level_bytes));
+    };
+    for (int n = 1; n < TextureCount; ++n) {
+        textures[n] = -1;
+    }
+
+    int frames = 0;
+    GLint base = BaseLevel(streamer.id(textures[0]));
+    bool finest_last = true;
+    while (streamer.pending_uploads() > 0 && frames < 100) {
+        streamer.Touch(textures[0]);
+        update();
+        GLint next = BaseLevel(streamer.id(textures[0]));
+        finest_last = finest_last && next < base;
+        base = next;
+        ++frames;
+    }
+    printf("%d frames to stream in %zu bytes at %zu per frame\n", frames, texture_bytes, upload_budget);
+    check(finest_last && base == 0 && streamer.resident_bytes() == texture_bytes &&
+          SameLevels(streamer.id(textures[0]), levels[0]), "levels stream in finest last");
+
+    // second texture fits next to the first
+    textures[1] = streamer.Add(images[1]);
+    for (frames = 0; streamer.pending_uploads() > 0 && frames < 100; ++frames) {
+        streamer.Touch(textures[1]);
+        update();
+    }
+    check(streamer.resident_bytes() == 2 * texture_bytes, "second texture fits");
+
+    // the third one takes the top level of the least recently used
+    textures[2] = streamer.Add(images[2]);
+    for (frames = 0; BaseLevel(streamer.id(textures[2])) > 0 && frames < 100; ++frames) {
+        streamer.Touch(textures[2]);
+        update();
+    }
+    GLint bases[TextureCount];
+    for (int n = 0; n < TextureCount; ++n) {
+        bases[n] = BaseLevel(streamer.id(textures[n]));
+    }
+    printf("base levels after the third texture: %d %d %d\n", bases[0], bases[1], bases[2]);
+    check(bases[0] == 1 && bases[1] == 0 && bases[2] == 0, "least recently used drops its top level");
+    check(SameLevels(streamer.id(textures[0]), levels[0]), "dropped texture keeps its other levels");
+
+    // used in the same frame, the first texture can't take its level back
+    for (int frame = 0; frame < 3; ++frame) {
+        for (int n = 0; n < TextureCount; ++n) {
+            streamer.Touch(textures[n]);
+        }
+        update();
+    }
+    check(BaseLevel(streamer.id(textures[0])) == 1 && BaseLevel(streamer.id(textures[1])) == 0 &&
+          BaseLevel(streamer.id(textures[2])) == 0, "textures used together don't evict each other");
+
+    // the first used alone gets it back from the least recently used now
+    for (frames = 0; BaseLevel(streamer.id(textures[0])) > 0 && frames < 100; ++frames) {
+        streamer.Touch(textures[0]);
+        update();
+    }
+    for (int n = 0; n < TextureCount; ++n) {
+        bases[n] = BaseLevel(streamer.id(textures[n]));
+    }
+    printf("base levels after using the first again: %d %d %d\n", bases[0], bases[1], bases[2]);
+    check(bases[0] == 0 && bases[1] + bases[2] == 1, "eviction follows use");
+    bool same = true;
+    for (int n = 0; n < TextureCount; ++n) {
+        same = same && SameLevels(streamer.id(textures[n]), levels[n]);
+    }
+    check(same, "all textures hold their data");
+    check(in_budget, "resident bytes match GL and stay in the budgets");
+
+    streamer.Destroy();
+    GLenum error = glGetError();
+    check(error == GL_NO_ERROR, "no GL error");
+    GetAsyncLogger().Stop();
+    return check.failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,163 @@
+// Fast projectiles don't tunnel: shots of up to 600 units/s, 60 units a
+// step at 10 Hz where an enemy is 2 across, each kill the enemy in their
+// way, at the same time whether stepped at 240 Hz or at 10 Hz.
+// Collisions are found like CheckCollision does, the grid as broadphase
+// and SweptSphereHit as narrowphase, resolved in time order. The point
+// test of the end of each step, what was there before the sweep, is
+// printed for comparison.
+//
+//   g++ -O2 -std=c++11 -I.. -I<glm> tunneling_check.cpp -o tunneling_check
+
+#include "collision_grid.hpp"
+#include <algorithm>
+#include <random>
+#include <cstdio>
+
+const float EnemyRadius = 1.0f;        // homework2's enemy collider
+const float ProjectileRadius = 0.5f;   // and projectile collider
+const int ShotCount = 100;
+const float Duration = 1.0f;
+
+struct Scene {
+    std::vector<glm::vec3> enemy_pos;
+    std::vector<glm::vec3> shot_velocity;
+};
+
+// Distance from p to the segment from the origin to b.
+float DistanceToShot(glm::vec3 p, glm::vec3 b){
+    float t = std::max(0.0f, std::min(1.0f, glm::dot(p, b) / glm::dot(b, b)));
+    return glm::length(p - b * t);
+}
+
+// Shots from the origin into the half space in front, each with an enemy
+// on its line and no other enemy near its path, so shot i kills enemy i.
+// Half the shots fly at the game's 15 units/s, the rest up to 600.
+Scene MakeScene(){
+    Scene scene;
+    std::mt19937 random(3);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    const float Clearance = EnemyRadius + ProjectileRadius + 0.5f;
+    while ((int)scene.enemy_pos.size() < ShotCount) {
+        float z = unit(random);
+        float around = 6.2831853f * unit(random);
+        float r = sqrtf(1.0f - z * z);
+        glm::vec3 direction(r * cosf(around), r * sinf(around), -z);
+        float speed = scene.enemy_pos.size() < ShotCount / 2 ? 15.0f : 15.0f + 585.0f * unit(random);
+        glm::vec3 enemy = direction * std::min(speed * Duration * 0.9f, 5.0f + 75.0f * unit(random));
+        bool clear = true;
+        for (const glm::vec3& other : scene.enemy_pos) {
+            clear = clear && DistanceToShot(other, enemy) > Clearance && DistanceToShot(enemy, other) > Clearance;
+        }
+        if (clear) {
+            scene.shot_velocity.push_back(direction * speed);
+            scene.enemy_pos.push_back(enemy);
+        }
+    }
+    return scene;
+}
+
+struct Kill {
+    int shot;
+    float time;
+};
+
+struct Hit {
+    float toi;
+    int shot;
+    int enemy;
+
+    bool operator<(const Hit& that) const {
+        if (toi != that.toi) return toi < that.toi;
+        if (shot != that.shot) return shot < that.shot;
+        return enemy < that.enemy;
+    }
+};
+
+// Kill of every enemy, shot -1 if it survives.
+std::vector<Kill> Run(const Scene& scene, int steps_per_second, bool swept){
+    size_t enemy_count = scene.enemy_pos.size();
+    std::vector<Kill> kills(enemy_count, Kill{-1, 0.0f});
+    std::vector<glm::vec3> pos(scene.shot_velocity.size(), glm::vec3(0.0f));
+    std::vector<glm::vec3> prev_pos(pos);
+    std::vector<uint8_t> shot_alive(pos.size(), 1);
+    std::vector<Hit> hits;
+    UniformGrid grid;
+    float dt = 1.0f / steps_per_second;
+    int steps = (int)(Duration * steps_per_second + 0.5f);
+    for (int step = 0; step < steps; ++step) {
+        for (size_t p = 0; p < pos.size(); ++p) {
+            prev_pos[p] = pos[p];
+            pos[p] += scene.shot_velocity[p] * dt;
+        }
+        grid.Build(enemy_count, 2.0f * EnemyRadius, [&](size_t i) { return scene.enemy_pos[i]; });
+        hits.clear();
+        for (size_t p = 0; p < pos.size(); ++p) {
+            if (!shot_alive[p]) {
+                continue;
+            }
+            glm::vec3 reach(ProjectileRadius + EnemyRadius);
+            glm::vec3 from = swept ? prev_pos[p] : pos[p];
+            grid.Query(glm::min(from, pos[p]) - reach, glm::max(from, pos[p]) + reach, [&](uint32_t e) {
+                float toi;
+                if (kills[e].shot < 0 && SweptSphereHit(from, pos[p], scene.enemy_pos[e], EnemyRadius + ProjectileRadius, toi)) {
+                    hits.push_back(Hit{toi, (int)p, (int)e});
+                }
+            });
+        }
+        // earliest first, every enemy and every shot once
+        std::sort(hits.begin(), hits.end());
+        for (const Hit& hit : hits) {
+            if (shot_alive[hit.shot] && kills[hit.enemy].shot < 0) {
+                shot_alive[hit.shot] = 0;
+                kills[hit.enemy].shot = hit.shot;
+                kills[hit.enemy].time = (step + (swept ? hit.toi : 1.0f)) * dt;
+            }
+        }
+    }
+    return kills;
+}
+
+// Enemies killed differently from reference, by another shot or more than
+// a millisecond apart.
+int CountDifferences(const std::vector<Kill>& kills, const std::vector<Kill>& reference){
+    int differences = 0;
+    for (size_t e = 0; e < kills.size(); ++e) {
+        if (kills[e].shot != reference[e].shot ||
+            (kills[e].shot >= 0 && fabsf(kills[e].time - reference[e].time) > 1e-3f)) {
+            differences += 1;
+        }
+    }
+    return differences;
+}
+
+int CountKills(const std::vector<Kill>& kills){
+    int count = 0;
+    for (const Kill& kill : kills) {
+        count += kill.shot >= 0 ? 1 : 0;
+    }
+    return count;
+}
+
+int main(){
+    Scene scene = MakeScene();
+    std::vector<Kill> reference = Run(scene, 240, true);
+    int misses = 0;
+    for (int e = 0; e < ShotCount; ++e) {
+        misses += reference[e].shot == e ? 0 : 1;
+    }
+    printf("240 Hz, swept: %d of %d enemies killed by their shot\n", ShotCount - misses, ShotCount);
+    int failures = misses == 0 ? 0 : 1;
+
+    const int rates[] = {120, 60, 30, 10};
+    for (int rate : rates) {
+        std::vector<Kill> kills = Run(scene, rate, true);
+        int differences = CountDifferences(kills, reference);
+        printf("%3d Hz, swept: %d killed, %d differ from 240 Hz\n", rate, CountKills(kills), differences);
+        failures += differences == 0 ? 0 : 1;
+    }
+    for (int rate : rates) {
+        std::vector<Kill> kills = Run(scene, rate, false);
+        printf("%3d Hz, point test at the end of the step: %d killed\n", rate, CountKills(kills));
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,80 @@
+// WaveSpawner places the same enemies for the same seed whatever the
+// number of job threads and the wave sizes, and never a NaN: with the
+// camera at the origin about one enemy in 9261 gets an offset of zero.
+//
+//   g++ -O2 -std=c++11 -pthread -I.. -I<glm> wave_spawner_check.cpp -o wave_spawner_check
+
+#include "job_system.hpp"
+#include "wave_spawner.hpp"
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+const size_t EnemyCount = 1000000;
+const uint32_t Seed = 42;
+
+// Places EnemyCount enemies in waves of the given sizes, in turn.
+void PlaceWaves(JobSystem& jobs, const size_t* wave_sizes, int wave_size_count, glm::vec3 camera_pos,
+                std::vector<glm::vec3>& pos, std::vector<glm::vec4>& quaternion){
+    WaveSpawner spawner;
+    spawner.Seed(Seed);
+    pos.assign(EnemyCount, glm::vec3(0.0f));
+    quaternion.assign(EnemyCount, glm::vec4(0.0f));
+    size_t placed = 0;
+    for (int k = 0; placed < EnemyCount; ++k) {
+        size_t count = std::min(wave_sizes[k % wave_size_count], EnemyCount - placed);
+        uint64_t first = spawner.Take(count);
+        glm::vec3* wave_pos = pos.data() + placed;
+        glm::vec4* wave_quaternion = quaternion.data() + placed;
+        jobs.ParallelFor(count, 4096, [&](size_t begin, size_t end) {
+            spawner.Place(first, begin, end, camera_pos, wave_pos, wave_quaternion);
+        });
+        placed += count;
+    }
+}
+
+int main(){
+    int failures = 0;
+    const glm::vec3 cameras[2] = {glm::vec3(0.0f), glm::vec3(1.0f, 2.0f, 3.0f)};
+    for (const glm::vec3& camera_pos : cameras) {
+        // one wave on the calling thread is the reference
+        std::vector<glm::vec3> reference_pos;
+        std::vector<glm::vec4> reference_quaternion;
+        {
+            JobSystem jobs;
+            jobs.Start(0);
+            const size_t one_wave = EnemyCount;
+            PlaceWaves(jobs, &one_wave, 1, camera_pos, reference_pos, reference_quaternion);
+            jobs.Stop();
+        }
+        size_t not_finite = 0;
+        for (size_t i = 0; i < EnemyCount; ++i) {
+            const glm::vec3& p = reference_pos[i];
+            const glm::vec4& q = reference_quaternion[i];
+            if (!std::isfinite(p.x + p.y + p.z) || !std::isfinite(q.x + q.y + q.z + q.w)) {
+                not_finite += 1;
+            }
+        }
+        printf("camera (%g %g %g): %zu enemies, %zu not finite\n",
+               camera_pos.x, camera_pos.y, camera_pos.z, EnemyCount, not_finite);
+        failures += not_finite == 0 ? 0 : 1;
+
+        const int worker_counts[] = {0, 1, 3, 7};
+        const size_t wave_sizes[] = {1, 1000, 4096, 99999};
+        for (int workers : worker_counts) {
+            JobSystem jobs;
+            jobs.Start(workers);
+            std::vector<glm::vec3> pos;
+            std::vector<glm::vec4> quaternion;
+            PlaceWaves(jobs, wave_sizes, 4, camera_pos, pos, quaternion);
+            jobs.Stop();
+            bool same = memcmp(pos.data(), reference_pos.data(), EnemyCount * sizeof(glm::vec3)) == 0 &&
+                        memcmp(quaternion.data(), reference_quaternion.data(), EnemyCount * sizeof(glm::vec4)) == 0;
+            printf("  %d workers, mixed waves: %s\n", workers, same ? "same" : "DIFFERENT");
+            failures += same ? 0 : 1;
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,204 @@
+#ifndef TEXTURE_STREAMER_HPP
+#define TEXTURE_STREAMER_HPP
+
+#include <GL/glew.h>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include "dds_texture.hpp"
+
+// Mip streaming for DDS textures. A texture starts with only its smallest
+// mip level resident and Update uploads the next finer level of the most
+// recently used textures, up to upload_budget bytes per frame.
+// GL_TEXTURE_BASE_LEVEL always points at the finest resident level, so
+// the texture is complete and sampleable the whole time.
+//
+// When the resident bytes would go over memory_budget, the top level of
+// the least recently used texture is dropped, never below the smallest
+// level. Textures used in the same frame don't evict each other. The image
+// data stays in memory so dropped levels can be uploaded again.
+//
+// GL has no way to release the storage of one level, so dropping a level
+// creates the texture again with the levels below it. Its GL name changes
+// then: textures are referred to by the index Add returns, and id() gives
+// the name to bind this frame.
+class TextureStreamer {
+public:
+    void Init(size_t upload_budget_bytes, size_t memory_budget_bytes){
+        upload_budget = upload_budget_bytes;
+        memory_budget = memory_budget_bytes;
+        frame = 0;
+        resident = 0;
+    }
+
+    // Creates the texture with its smallest level resident and takes over
+    // the image data. Returns its index, -1 for an empty image.
+    int Add(DDSImage& image){
+        if (image.data.empty() || image.mip_count == 0) {
+            return -1;
+        }
+        textures.push_back(Texture());
+        Texture& texture = textures.back();
+        texture.image.format = image.format;
+        texture.image.width = image.width;
+        texture.image.height = image.height;
+        texture.image.mip_count = image.mip_count;
+        texture.image.data.swap(image.data);
+        texture.level_offset.resize(image.mip_count + 1);
+        for (uint32_t level = 0; level <= image.mip_count; ++level) {
+            texture.level_offset[level] = DDSLevelOffset(texture.image, level);
+        }
+        texture.last_used = frame;
+        order.reserve(textures.size());
+
+        CreateTexture(texture, image.mip_count - 1);
+        return (int)textures.size() - 1;
+    }
+
+    // GL name of the texture, until the next Update.
+    GLuint id(int texture) const { return textures[texture].id; }
+
+    // Marks the texture as used this frame.
+    void Touch(int texture){
+        textures[texture].last_used = frame;
+    }
+
+    // Once per frame.
+    void Update(){
+        frame += 1;
+        if (pending_uploads() == 0) {
+            return;
+        }
+        // most recently used first
+        order.clear();
+        for (uint32_t i = 0; i < textures.size(); ++i) {
+            order.push_back(i);
+        }
+        std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+            return textures[a].last_used > textures[b].last_used;
+        });
+
+        size_t uploaded = 0;
+        for (uint32_t i : order) {
+            Texture& texture = textures[i];
+            while (texture.base_level > 0) {
+                uint32_t level = texture.base_level - 1;
+                size_t size = LevelBytes(texture, level);
+                // a level over the budget still goes through alone
+                if (uploaded > 0 && uploaded + size > upload_budget) {
+                    return;
+                }
+                if (!MakeRoom(size, texture.last_used, uploaded)) {
+                    break;
+                }
+                glBindTexture(GL_TEXTURE_2D, texture.id);
+                UploadLevel(texture, level);
+                uploaded += size;
+            }
+        }
+    }
+
+    void Destroy(){
+        for (Texture& texture : textures) {
+            glDeleteTextures(1, &texture.id);
+        }
+        textures.clear();
+        resident = 0;
+    }
+
+    size_t resident_bytes() const { return resident; }
+
+    // Bytes of the levels that aren't resident.
+    size_t pending_bytes() const {
+        size_t bytes = 0;
+        for (const Texture& texture : textures) {
+            bytes += texture.level_offset[texture.base_level];
+        }
+        return bytes;
+    }
+
+    // Number of levels that aren't resident.
+    uint32_t pending_uploads() const {
+        uint32_t levels = 0;
+        for (const Texture& texture : textures) {
+            levels += texture.base_level;
+        }
+        return levels;
+    }
+
+private:
+    struct Texture {
+        GLuint id = 0;
+        DDSImage image;
+        std::vector<size_t> level_offset; // mip_count + 1 entries
+        uint32_t base_level = 0;          // finest resident level
+        uint64_t last_used = 0;
+    };
+
+    static size_t LevelBytes(const Texture& texture, uint32_t level){
+        return texture.level_offset[level + 1] - texture.level_offset[level];
+    }
+
+    // The texture must be bound, level is base_level - 1.
+    void UploadLevel(Texture& texture, uint32_t level){
+        const DDSImage& image = texture.image;
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glCompressedTexImage2D(GL_TEXTURE_2D, level, image.format,
+                               DDSLevelWidth(image, level), DDSLevelHeight(image, level), 0,
+                               (GLsizei)LevelBytes(texture, level), image.data.data() + texture.level_offset[level]);
+        texture.base_level = level;
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+        resident += LevelBytes(texture, level);
+    }
+
+    // A new GL texture with levels [base_level, mip_count) resident, the
+    // bytes uploaded.
+    size_t CreateTexture(Texture& texture, uint32_t base_level){
+        glGenTextures(1, &texture.id);
+        glBindTexture(GL_TEXTURE_2D, texture.id);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, texture.image.mip_count - 1);
+        texture.base_level = texture.image.mip_count;
+        for (uint32_t level = texture.image.mip_count; level-- > base_level;) {
+            UploadLevel(texture, level);
+        }
+        return texture.level_offset[texture.image.mip_count] - texture.level_offset[base_level];
+    }
+
+    // Creates the texture again without its top level. The levels below
+    // it are at most a third of its size; the bytes uploaded.
+    size_t DropLevel(Texture& texture){
+        GLuint dropped_id = texture.id;
+        resident -= texture.level_offset[texture.image.mip_count] - texture.level_offset[texture.base_level];
+        size_t uploaded = CreateTexture(texture, texture.base_level + 1);
+        glDeleteTextures(1, &dropped_id);
+        return uploaded;
+    }
+
+    // Drops top levels of textures used before last_used until bytes fit
+    // in the memory budget. The levels uploaded again count in uploaded.
+    bool MakeRoom(size_t bytes, uint64_t last_used, size_t& uploaded){
+        while (resident + bytes > memory_budget) {
+            Texture* victim = nullptr;
+            for (Texture& texture : textures) {
+                if (texture.last_used < last_used && texture.base_level + 1 < texture.image.mip_count &&
+                    (victim == nullptr || texture.last_used < victim->last_used)) {
+                    victim = &texture;
+                }
+            }
+            if (victim == nullptr) {
+                return false;
+            }
+            uploaded += DropLevel(*victim);
+        }
+        return true;
+    }
+
+    std::vector<Texture> textures;
+    std::vector<uint32_t> order;
+    size_t upload_budget = 0;
+    size_t memory_budget = 0;
+    size_t resident = 0;
+    uint64_t frame = 0;
+};
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef WAVE_SPAWNER_HPP
+#define WAVE_SPAWNER_HPP
+
+#include <glm/glm.hpp>
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+
+// Random numbers without a sequential state: the value for (key, counter)
+// is a SplitMix64 hash of the two. Any thread can draw any part of the
+// sequence in any order and gets the same numbers.
+inline uint64_t CounterRandom(uint64_t key, uint64_t counter){
+    uint64_t z = key + (counter + 1) * 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// Field k (16 bits) of bits scaled to [0, n).
+inline int RandomField(uint64_t bits, int k, int n){
+    return (int)((((bits >> (16 * k)) & 0xFFFF) * (uint64_t)n) >> 16);
+}
+
+// Places enemies: enemy number n of a session always gets the same
+// position and rotation for the same seed, whichever wave, thread or
+// chunk it is placed by. The draws are the ones CreateEnemy took from
+// rand(): a rotation of 0..359 degrees about an axis in [-10, 10]^3, and a
+// position in [-10, 10]^3 around the camera, pushed out to 12..31 units
+// from the origin. The angles are whole degrees, their sines and cosines
+// come from a table.
+class WaveSpawner {
+public:
+    WaveSpawner(){
+        for (int angle = 0; angle < 360; ++angle) {
+            float half_angle = (angle * 0.5) * 3.14159 / 180.0;
+            half_sin[angle] = sin(half_angle);
+            half_cos[angle] = cos(half_angle);
+        }
+    }
+
+    void Seed(uint32_t seed){
+        key = CounterRandom(seed, 0);
+        spawned = 0;
+    }
+
+    // Numbers count enemies, returns the first one.
+    uint64_t Take(size_t count){
+        uint64_t first = spawned;
+        spawned += count;
+        return first;
+    }
+
+    uint64_t spawned_count() const { return spawned; }
+
+    // Writes enemies first + [begin, end) to pos[begin, end) and
+    // quaternion[begin, end). Safe to call from several threads.
+    void Place(uint64_t first, size_t begin, size_t end, glm::vec3 camera_pos,
+               glm::vec3* pos, glm::vec4* quaternion) const {
+        for (size_t i = begin; i < end; ++i) {
+            uint64_t a = CounterRandom(key, (first + i) * 2);
+            uint64_t b = CounterRandom(key, (first + i) * 2 + 1);
+            int angle = RandomField(a, 0, 360);
+            glm::vec3 axis(RandomField(a, 1, 21) - 10, RandomField(a, 2, 21) - 10, RandomField(a, 3, 21) - 10);
+            glm::vec3 offset(RandomField(b, 0, 21) - 10, RandomField(b, 1, 21) - 10, RandomField(b, 2, 21) - 10);
+            float radius = (float)(RandomField(b, 3, 20) + 12);
+
+            float axis_length2 = glm::dot(axis, axis);
+            if (axis_length2 == 0.0f) {
+                // normalizing it would give NaN
+                axis = glm::vec3(0.0f, 1.0f, 0.0f);
+                axis_length2 = 1.0f;
+            }
+            float s = half_sin[angle] / std::sqrt(axis_length2);
+            quaternion[i] = glm::vec4(axis.x * s, axis.y * s, axis.z * s, half_cos[angle]);
+            glm::vec3 p = offset + camera_pos;
+            float p_length2 = glm::dot(p, p);
+            if (p_length2 == 0.0f) {
+                // the offset cancelled the camera position, any direction will do
+                p = glm::vec3(0.0f, 1.0f, 0.0f);
+                p_length2 = 1.0f;
+            }
+            pos[i] = p * (radius / std::sqrt(p_length2));
+        }
+    }
+
+private:
+    uint64_t key = 0;
+    uint64_t spawned = 0;
+    float half_sin[360];
+    float half_cos[360];
+};
+
+#endif